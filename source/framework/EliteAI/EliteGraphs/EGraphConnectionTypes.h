@@ -38,4 +38,11 @@ namespace Elite
 		// the cost of traversing the edge
 		float m_Cost;
 	};
+
+	//Packed connection stored in the compressed adjacency of IGraph, only holds what a search needs
+	struct CompactConnection
+	{
+		int to;
+		float cost;
+	};
 }
\ No newline at end of file
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <type_traits>
+
+namespace Elite
+{
+	struct SlabPoolStatistics
+	{
+		int nrOfObjects = 0; // objects alive
+		int nrOfFreeSlots = 0; // slots of destroyed objects, handed out again first
+		int nrOfSlabs = 0;
+		size_t nrOfBytes = 0; // all slabs, free and unused slots included
+	};
+
+	//Hands out objects of one type from slabs of SlabSize objects instead of allocating every object on the heap.
+	//The slot of a destroyed object goes on a free list that Create takes from first, so removing objects and creating them
+	//again doesn't allocate. Release destroys the objects that are still alive and frees all slabs in one go.
+	template<class T>
+	class SlabPool
+	{
+	public:
+		SlabPool() = default;
+		~SlabPool() { Release(); }
+
+		template<typename... T_Args>
+		T* Create(T_Args&&... args);
+		// pObject has to come from this pool, nullptr is ignored
+		void Destroy(T* pObject);
+		void Release();
+
+		SlabPoolStatistics GetStatistics() const;
+
+	private:
+		enum { SlabSize = 1024 };
+
+		// a slot holds an object or, once the object is destroyed, the next free slot
+		// there's no room for an alive flag (it would pad every slot), Release finds the free slots through the free list
+		union Slot
+		{
+			typename std::aligned_storage<sizeof(T), alignof(T)>::type object;
+			Slot* pNextFree;
+		};
+
+		std::vector<std::unique_ptr<Slot[]>> m_Slabs;
+		int m_NrOfUsedSlots = SlabSize; // slots of the last slab handed out so far
+		Slot* m_pFreeSlots = nullptr;
+		int m_NrOfObjects = 0;
+		int m_NrOfFreeSlots = 0;
+
+		SlabPool(const SlabPool&) = delete;
+		SlabPool& operator=(const SlabPool&) = delete;
+	};
+
+	template<class T>
+	template<typename... T_Args>
+	inline T* SlabPool<T>::Create(T_Args&&... args)
+	{
+		Slot* pSlot{ m_pFreeSlots };
+		if (pSlot)
+		{
+			m_pFreeSlots = pSlot->pNextFree;
+			--m_NrOfFreeSlots;
+		}
+		else
+		{
+			if (m_NrOfUsedSlots == SlabSize)
+			{
+				m_Slabs.emplace_back(new Slot[SlabSize]);
+				m_NrOfUsedSlots = 0;
+			}
+			pSlot = &m_Slabs.back()[m_NrOfUsedSlots++];
+		}
+
+		T* pObject{ new (&pSlot->object) T(std::forward<T_Args>(args)...) };
+		++m_NrOfObjects;
+		return pObject;
+	}
+
+	template<class T>
+	inline void SlabPool<T>::Destroy(T* pObject)
+	{
+		if (!pObject)
+			return;
+
+		Slot* pSlot{ reinterpret_cast<Slot*>(pObject) };
+		pObject->~T();
+		pSlot->pNextFree = m_pFreeSlots;
+		m_pFreeSlots = pSlot;
+		--m_NrOfObjects;
+		++m_NrOfFreeSlots;
+	}
+
+	template<class T>
+	inline void SlabPool<T>::Release()
+	{
+		if (!std::is_trivially_destructible<T>::value && m_NrOfObjects > 0)
+		{
+			//Mark the free slots, looking up their slab among the slabs sorted by address, every other used slot holds an object
+			std::vector<Slot*> sortedSlabs(m_Slabs.size());
+			for (size_t s{ 0 }; s < m_Slabs.size(); ++s)
+				sortedSlabs[s] = m_Slabs[s].get();
+			std::sort(sortedSlabs.begin(), sortedSlabs.end());
+
+			std::vector<bool> isFree(sortedSlabs.size() * SlabSize, false);
+			for (Slot* pSlot{ m_pFreeSlots }; pSlot; pSlot = pSlot->pNextFree)
+			{
+				const size_t s(std::upper_bound(sortedSlabs.begin(), sortedSlabs.end(), pSlot) - sortedSlabs.begin() - 1);
+				isFree[s * SlabSize + (pSlot - sortedSlabs[s])] = true;
+			}
+
+			for (size_t s{ 0 }; s < sortedSlabs.size(); ++s)
+			{
+				int nrOfSlots{ (sortedSlabs[s] == m_Slabs.back().get()) ? m_NrOfUsedSlots : int(SlabSize) };
+				for (int i{ 0 }; i < nrOfSlots; ++i)
+				{
+					if (!isFree[s * SlabSize + i])
+						reinterpret_cast<T*>(&sortedSlabs[s][i].object)->~T();
+				}
+			}
+		}
+
+		m_Slabs.clear();
+		m_NrOfUsedSlots = SlabSize;
+		m_pFreeSlots = nullptr;
+		m_NrOfObjects = 0;
+		m_NrOfFreeSlots = 0;
+	}
+
+	template<class T>
+	inline SlabPoolStatistics SlabPool<T>::GetStatistics() const
+	{
+		SlabPoolStatistics statistics{};
+		statistics.nrOfObjects = m_NrOfObjects;
+		statistics.nrOfFreeSlots = m_NrOfFreeSlots;
+		statistics.nrOfSlabs = int(m_Slabs.size());
+		statistics.nrOfBytes = m_Slabs.size() * SlabSize * sizeof(Slot) + m_Slabs.capacity() * sizeof(std::unique_ptr<Slot[]>);
+		return statistics;
+	}
+}
@@ -9,6 +9,7 @@
 #include "EIGraph.h"
 #include "EGraphConnectionTypes.h"
 #include "EGraphNodeTypes.h"
+#include <thread>
 
 namespace Elite
 {
@@ -16,15 +17,21 @@ namespace Elite
 	class GridGraph : public IGraph<T_NodeType, T_ConnectionType>
 	{
 	public:
-		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5);
+		// An implicit grid doesn't create connection objects, neighbors and costs are computed from the cell index,
+		// the walkable cells and the terrain of the cells instead
+		// The connections of the other grids are built over bands of rows by nrOfThreads threads, 0 takes the number of hardware threads
+		GridGraph(int columns, int rows, int cellSize, bool isDirectionalGraph, bool isConnectedDiagonally, float costStraight = 1.f, float costDiagonal = 1.5, bool isImplicit = false, int nrOfThreads = 1);
 
 		using IGraph::GetNode;
 		T_NodeType* GetNode(int col, int row) const { return m_Nodes[GetIndex(col, row)]; }
-		const ConnectionList& GetConnections(const T_NodeType& node) const { return m_Connections[node.GetIndex()]; }
-		const ConnectionList& GetConnections(int idx) const { return m_Connections[idx]; }
+		const ConnectionList& GetConnections(const T_NodeType& node) const { return GetNodeConnections(node.GetIndex()); }
+		const ConnectionList& GetConnections(int idx) const { return GetNodeConnections(idx); }
 
 		int GetRows() const { return m_NrOfRows; }
 		int GetColumns() const { return m_NrOfColumns; }
+		bool IsConnectedDiagonally() const { return m_IsConnectedDiagionally; }
+		float GetCostStraight() const { return m_DefaultCostStraight; }
+		float GetCostDiagonal() const { return m_DefaultCostDiagonal; }
 
 		bool IsWithinBounds(int col, int row) const;
 		int GetIndex(int col, int row) const { return row * m_NrOfColumns + col; }
@@ -40,7 +47,41 @@ namespace Elite
 
 		int GetNodeFromWorldPos(Vector2 pos = ZeroVector2) const;
 
+		bool IsImplicit() const { return m_HasImplicitConnections; }
+		// increases every time isolating or unisolating changes a cell, data derived from the cells can compare it to know it's outdated
+		unsigned int GetVersion() const { return m_Version; }
+		// appends the cells changed since sinceVersion (in order of change, a cell can appear more than once)
+		// returns false if the journal doesn't reach back that far anymore, everything derived from the cells has to be rebuilt then
+		bool GetChangedCells(unsigned int sinceVersion, vector<int>& changedCells) const;
+		// true when every walkable cell has the default terrain cost, so a step only costs the straight or diagonal cost
+		bool HasUniformTerrain() const { return m_NrOfCostlyCells == 0; }
+		bool IsWalkable(int idx) const { return ((m_WalkableCells[idx >> 6] >> (idx & 63)) & 1) != 0; }
+		// returns true if every cell in [firstCol, lastCol] of the row (or [firstRow, lastRow] of the column) is walkable, 64 cells are tested at once
+		bool IsRowRunWalkable(int row, int firstCol, int lastCol) const;
+		bool IsColumnRunWalkable(int col, int firstRow, int lastRow) const;
+		// returns true if a path can step from one cell to the adjacent other cell
+		bool AreAdjacentCellsConnected(int fromIdx, int toIdx) const;
+
+		// Calls function(int to, float cost) for every neighbor of the node, in implicit mode the neighbors are computed on the fly
+		template<typename T_Function>
+		void ForEachNeighbor(int idx, T_Function&& function) const;
+
+		// Both keep the walkable cells and the terrain of the cell up to date, set the terrain of the node first
+		// Only the connections between the cell and its adjacent cells are touched, the grid doesn't connect other cells
+		void IsolateNode(int idx);
 		void UnIsolateNode(int idx);
+
+		// Connected components of the walkable cells, kept up to date on every edit
+		// label of the component of the cell, invalid_node_index for a cell that isn't walkable
+		int GetComponent(int idx) const { return m_ComponentLabels[idx]; }
+		// returns true if a path exists between both cells, without searching
+		bool AreConnected(int fromIdx, int toIdx) const { return m_ComponentLabels[fromIdx] != invalid_node_index && m_ComponentLabels[fromIdx] == m_ComponentLabels[toIdx]; }
+		// the cell a path from fromIdx can reach that is closest to toIdx (straight line distance on the grid), toIdx itself if it is connected
+		// returns fromIdx if that cell isn't walkable
+		int GetClosestConnectedCell(int fromIdx, int toIdx) const;
+
+		// adds the node block and the per cell data (walkable bits, terrain costs, journal, components) to the graph memory
+		virtual GraphMemoryStatistics GetMemoryStatistics() const override;
 	private:
 		
 		int m_NrOfColumns;
@@ -54,15 +95,77 @@ namespace Elite
 		const vector<Vector2> m_StraightDirections = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 } };
 		const vector<Vector2> m_DiagonalDirections = { { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
 
+		// one bit per cell, set when the cell can be entered
+		// the transposed copy stores the cells column by column, so the cells of a column are consecutive bits as well
+		vector<uint64_t> m_WalkableCells;
+		vector<uint64_t> m_WalkableCellsTransposed;
+		// terrain cost of every cell, clamped to a byte (walls are never walkable so their cost isn't needed)
+		vector<uint8_t> m_CellTerrainCosts;
+		int m_NrOfCostlyCells = 0; // walkable cells with a terrain cost other than 1
+		unsigned int m_Version = 0;
+		// change journal: m_ChangedCells[i] is the cell changed by version m_FirstJournalVersion + i + 1
+		// only the most recent changes are kept, so the journal stays small when nobody reads it
+		enum { MaxJournalSize = 4096 };
+		vector<int> m_ChangedCells;
+		unsigned int m_FirstJournalVersion = 0;
+		// component label of every cell, the number of cells per label and the labels no component uses
+		vector<int> m_ComponentLabels;
+		vector<int> m_ComponentSizes;
+		vector<int> m_FreeComponentLabels;
+		// scratch buffers of the component updates
+		enum { MaxNrOfSplitSearches = 8 };
+		enum { MinRowsPerBand = 64 }; // fewer rows aren't worth a thread when building the connections
+		vector<int> m_ComponentQueue;
+		vector<vector<int>> m_SplitQueues; // cells reached by every search of a split, in the order they were reached
+		vector<unsigned int> m_SplitVisits; // search that reached the cell, as m_SplitId * MaxNrOfSplitSearches + search
+		unsigned int m_SplitId = 0;
+
+		// the nodes of all cells in one block, created in one go: the node pointers of the graph point into it,
+		// so there is no allocation (and allocator overhead) per node. The block never grows, the pointers stay valid
+		vector<T_NodeType> m_NodeStorage;
+
 		// graph creation helper functions
+		// creates the connections of all cells in one pass, without the duplicate checks of AddConnection
+		void BuildConnections(int nrOfThreads);
+		// writes the connections of the cell to pConnections in the order the cell by cell construction adds them, returns how many there are
+		int GetCellConnections(int idx, int col, int row, CompactConnection* pConnections) const;
 		void AddConnectionsToAdjacentCells(int idx, int col, int row);
-		void AddConnectionsInDirections(int idx, int col, int row, vector<Vector2> directions);
+		void AddConnectionsInDirections(int idx, int col, int row, const vector<Vector2>& directions);
 
 		float GetConnectionCost(int fromIdx, int toIdx) const;
+
+		int GetCellTerrainCost(int idx) const;
+		// reads the terrain of the node, an isolated cell is never walkable. Returns true if the walkability or terrain cost of the cell changed
+		bool UpdateCell(int idx, bool isIsolated = false);
+		// increases the version and journals the cell
+		void RecordChange(int idx);
+		void SetWalkable(int idx, bool isWalkable);
+		static bool AreAllBitsSet(const vector<uint64_t>& bits, int firstBit, int lastBit);
+
+		// calls function(int neighborIdx) for every walkable cell next to the cell, the connections aren't needed for that
+		template<typename T_Function>
+		void ForEachWalkableCell(int idx, T_Function&& function) const;
+		// calls function(int neighborIdx) for every cell next to the cell, walkable or not
+		template<typename T_Function>
+		void ForEachAdjacentCell(int idx, T_Function&& function) const;
+		// removes the connections between the cell and its adjacent cells, in both directions
+		void DisconnectCell(int idx);
+		void BuildComponents();
+		// the cell became walkable: joins it to the components around it, merging them if it connects several
+		void AddToComponents(int idx);
+		// the cell isn't walkable anymore: finds out if its component fell apart and labels the parts
+		void RemoveFromComponents(int idx);
+		int CreateComponent();
+		// gives every cell of the component of the start cell the new label
+		void RelabelComponent(int startIdx, int newLabel);
 		//void AddCheckedConnection(int idx, int neighborCol, int neighborRow, float cost);
 
 	
 		friend class EGraphRenderer;
+
+		// the nodes live in m_NodeStorage, a copy would point to the nodes of the original
+		GridGraph(const GridGraph&) = delete;
+		GridGraph& operator=(const GridGraph&) = delete;
 	};
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -73,7 +176,9 @@ namespace Elite
 		bool isDirectionalGraph, 
 		bool isConnectedDiagonally, 
 		float costStraight /* = 1.f*/, 
-		float costDiagonal /* = 1.5f */)
+		float costDiagonal /* = 1.5f */,
+		bool isImplicit /* = false */,
+		int nrOfThreads /* = 1 */)
 		: IGraph(isDirectionalGraph)
 		, m_NrOfColumns(columns)
 		, m_NrOfRows(rows)
@@ -82,25 +187,110 @@ namespace Elite
 		, m_DefaultCostStraight(costStraight)
 		, m_DefaultCostDiagonal(costDiagonal)
 	{
-		// Create all nodes
-		for (auto r = 0; r < m_NrOfRows; ++r)
+		// Leave room for every possible grid connection in the compressed adjacency, so isolating and restoring nodes never triggers a rebuild
+		m_CompactMinCapacity = m_IsConnectedDiagionally ? 8 : 4;
+		m_HasImplicitConnections = isImplicit;
+		m_OwnsNodes = false;
+
+		// Create all nodes in one block, cell by cell so the index of a node is its position in the block
+		int nrOfCells{ m_NrOfColumns * m_NrOfRows };
+		m_NodeStorage.reserve(nrOfCells);
+		m_Nodes.reserve(nrOfCells);
+		if (!m_HasImplicitConnections)
+			m_Connections.reserve(nrOfCells);
+		for (int idx = 0; idx < nrOfCells; ++idx)
 		{
-			for (auto c = 0; c < m_NrOfColumns; ++c)
-			{
-				int idx = GetIndex(c, r);
-				AddNode(new T_NodeType(idx));
-			}
+			m_NodeStorage.emplace_back(idx);
+			AddNode(&m_NodeStorage.back());
 		}
 
-		// Create connections in each valid direction on each node
-		for (auto r = 0; r < m_NrOfRows; ++r)
+		m_WalkableCells.resize((nrOfCells + 63) / 64, 0);
+		m_WalkableCellsTransposed.resize((nrOfCells + 63) / 64, 0);
+		m_CellTerrainCosts.resize(nrOfCells);
+		for (int idx = 0; idx < nrOfCells; ++idx)
+			UpdateCell(idx);
+		BuildComponents();
+
+		if (m_HasImplicitConnections)
+			return;
+
+		BuildConnections(nrOfThreads);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::BuildConnections(int nrOfThreads)
+	{
+		// Every cell gets room for all its possible connections, which is the layout of the compressed adjacency as well
+		const int nrOfCells{ m_NrOfColumns * m_NrOfRows };
+		const int stride{ m_CompactMinCapacity };
+		vector<CompactConnection> connections(size_t(nrOfCells) * stride);
+		vector<int> ends(nrOfCells);
+
+		auto buildBand = [&](int firstRow, int endRow)
 		{
-			for (auto c = 0; c < m_NrOfColumns; ++c)
+			for (int r = firstRow; r < endRow; ++r)
 			{
-				int idx = GetIndex(c, r);
-				AddConnectionsToAdjacentCells(idx, c, r);
+				for (int c = 0; c < m_NrOfColumns; ++c)
+				{
+					int idx = GetIndex(c, r);
+					ends[idx] = idx * stride + GetCellConnections(idx, c, r, &connections[idx * stride]);
+				}
 			}
+		};
+
+		// Every band writes the connections of its own cells only
+		if (nrOfThreads <= 0)
+			nrOfThreads = int(std::thread::hardware_concurrency());
+		const int maxNrOfBands{ (m_NrOfRows + MinRowsPerBand - 1) / MinRowsPerBand };
+		int nrOfBands{ (nrOfThreads < maxNrOfBands) ? nrOfThreads : maxNrOfBands };
+		if (nrOfBands < 1)
+			nrOfBands = 1;
+		const int rowsPerBand{ (m_NrOfRows + nrOfBands - 1) / nrOfBands };
+
+		vector<std::thread> workers;
+		for (int band = 1; band < nrOfBands; ++band)
+		{
+			const int firstRow{ band * rowsPerBand };
+			const int endRow{ (firstRow + rowsPerBand < m_NrOfRows) ? firstRow + rowsPerBand : m_NrOfRows };
+			if (firstRow < endRow)
+				workers.emplace_back(buildBand, firstRow, endRow);
+		}
+		buildBand(0, (rowsPerBand < m_NrOfRows) ? rowsPerBand : m_NrOfRows);
+		for (std::thread& worker : workers)
+			worker.join();
+
+		// The connection objects come from the pool of the graph, which isn't shared between threads
+		AddConnections(std::move(connections), stride, std::move(ends));
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	int GridGraph<T_NodeType, T_ConnectionType>::GetCellConnections(int idx, int col, int row, CompactConnection* pConnections) const
+	{
+		// In an undirected grid the cells before this one (in row order) added their connection to it first: up left, up, up right and left
+		// Each cell of a directed grid only has the connections it added itself: the straight directions, then the diagonal ones
+		static const int undirectedDiagonalOffsets[8][2] = { { -1, -1 }, { 0, -1 }, { 1, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 }, { 1, 1 }, { -1, 1 } };
+		static const int undirectedStraightOffsets[4][2] = { { 0, -1 }, { -1, 0 }, { 1, 0 }, { 0, 1 } };
+		static const int directedOffsets[8][2] = { { 1, 0 }, { 0, 1 }, { -1, 0 }, { 0, -1 }, { 1, 1 }, { -1, 1 }, { -1, -1 }, { 1, -1 } };
+
+		const int nrOfOffsets{ m_IsConnectedDiagionally ? 8 : 4 };
+		const int (*offsets)[2]{ m_IsDirectionalGraph ? directedOffsets
+			: (m_IsConnectedDiagionally ? undirectedDiagonalOffsets : undirectedStraightOffsets) };
+
+		int nrOfConnections{ 0 };
+		for (int o = 0; o < nrOfOffsets; ++o)
+		{
+			int neighborCol = col + offsets[o][0];
+			int neighborRow = row + offsets[o][1];
+			if (!IsWithinBounds(neighborCol, neighborRow))
+				continue;
+
+			int neighborIdx = GetIndex(neighborCol, neighborRow);
+			float connectionCost = GetConnectionCost(idx, neighborIdx);
+			if (connectionCost < 100000) //Extra check for different terrain types
+				pConnections[nrOfConnections++] = CompactConnection{ neighborIdx, connectionCost };
 		}
+
+		return nrOfConnections;
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -122,46 +312,122 @@ namespace Elite
 		}
 	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	bool GridGraph<T_NodeType, T_ConnectionType>::AreAdjacentCellsConnected(int fromIdx, int toIdx) const
+	{
+		if (m_HasImplicitConnections)
+			return IsWalkable(fromIdx) && IsWalkable(toIdx);
+
+		return GetConnection(fromIdx, toIdx) != nullptr;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	template<typename T_Function>
+	inline void GridGraph<T_NodeType, T_ConnectionType>::ForEachNeighbor(int idx, T_Function&& function) const
+	{
+		if (!m_HasImplicitConnections)
+		{
+			IGraph::ForEachNeighbor(idx, std::forward<T_Function>(function));
+			return;
+		}
+
+		// Same directions in the same order as the explicit connections, straight ones first
+		static const int directionCols[8]{ 1, 0, -1, 0, 1, -1, -1, 1 };
+		static const int directionRows[8]{ 0, 1, 0, -1, 1, 1, -1, -1 };
+
+		if (!IsWalkable(idx))
+			return;
+
+		const int col{ idx % m_NrOfColumns };
+		const int row{ idx / m_NrOfColumns };
+		const float terrainCost{ float(m_CellTerrainCosts[idx]) };
+		const int nrOfDirections{ m_IsConnectedDiagionally ? 8 : 4 };
+		for (int d{ 0 }; d < nrOfDirections; ++d)
+		{
+			int neighborCol{ col + directionCols[d] };
+			int neighborRow{ row + directionRows[d] };
+			if (!IsWithinBounds(neighborCol, neighborRow))
+				continue;
+
+			int neighborIdx{ GetIndex(neighborCol, neighborRow) };
+			if (!IsWalkable(neighborIdx))
+				continue;
+
+			// matches GetConnectionCost: the average terrain cost of both cells scales the step cost
+			float cost{ (d < 4) ? m_DefaultCostStraight : m_DefaultCostDiagonal };
+			function(neighborIdx, cost * ((terrainCost + float(m_CellTerrainCosts[neighborIdx])) / 2.0f));
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::IsolateNode(int idx)
+	{
+		const bool wasWalkable{ IsWalkable(idx) };
+		if (UpdateCell(idx, true))
+			RecordChange(idx);
+		if (wasWalkable)
+			RemoveFromComponents(idx);
+
+		if (!m_HasImplicitConnections)
+			DisconnectCell(idx);
+	}
+
 	template<class T_NodeType, class T_ConnectionType>
 	void GridGraph<T_NodeType, T_ConnectionType>::UnIsolateNode(int idx)
 	{
-		//Isolate it to make sure it was isolated
-		IsolateNode(idx);
+		const bool wasWalkable{ IsWalkable(idx) };
+		if (m_HasImplicitConnections)
+		{
+			if (UpdateCell(idx))
+				RecordChange(idx);
+			if (!wasWalkable && IsWalkable(idx))
+				AddToComponents(idx);
+			else if (wasWalkable && !IsWalkable(idx))
+				RemoveFromComponents(idx);
+			return;
+		}
 
-		//Add connections from this node to the neighbouring nodes
+		//Isolate it to make sure it was isolated, the cell itself is updated once the connections are back
+		DisconnectCell(idx);
+
+		//Add connections from this node to the neighbouring nodes, in an undirected grid that adds the ones back as well
 		Vector2 rowCol = GetNodePos(idx);
 		AddConnectionsToAdjacentCells(idx, (int)rowCol.x, (int)rowCol.y);
 
-		//Add connections to the neigbouring nodes to this node
-		for (auto d : m_StraightDirections)
+		//Add connections from the neighbouring nodes to this node, the connections between the neighbours themselves didn't change
+		if (m_IsDirectionalGraph)
 		{
-			int neighborCol = (int)rowCol.x + (int)d.x;
-			int neighborRow = (int)rowCol.y + (int)d.y;
-			int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-			if (IsWithinBounds(neighborCol, neighborRow))
+			ForEachAdjacentCell(idx, [&](int neighborIdx)
 			{
-				AddConnectionsToAdjacentCells(neighborIdx, neighborCol, neighborRow);
-			}
+				float connectionCost = GetConnectionCost(neighborIdx, idx);
+				if (IsUniqueConnection(neighborIdx, idx)
+					&& connectionCost < 100000) //Extra check for different terrain types
+					AddConnection(neighborIdx, idx, connectionCost);
+			});
 		}
 
-		if (m_IsConnectedDiagionally)
-		{
-			for (auto d : m_DiagonalDirections)
-			{
-				int neighborCol = (int)rowCol.x + (int)d.x;
-				int neighborRow = (int)rowCol.y + (int)d.y;
-				int neighborIdx = neighborRow * m_NrOfColumns + neighborCol;
-				if (IsWithinBounds(neighborCol, neighborRow))
-				{
-					AddConnectionsToAdjacentCells(neighborIdx, neighborCol, neighborRow);
-				}
-			}
-		}
+		if (UpdateCell(idx))
+			RecordChange(idx);
+		if (!wasWalkable && IsWalkable(idx))
+			AddToComponents(idx);
+		else if (wasWalkable && !IsWalkable(idx))
+			RemoveFromComponents(idx);
+	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::DisconnectCell(int idx)
+	{
+		// RemoveConnection removes the opposite connection of an undirected grid too
+		ForEachAdjacentCell(idx, [&](int neighborIdx)
+		{
+			RemoveConnection(idx, neighborIdx);
+			if (m_IsDirectionalGraph)
+				RemoveConnection(neighborIdx, idx);
+		});
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
-	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsInDirections(int idx, int col, int row, vector<Elite::Vector2> directions)
+	void GridGraph<T_NodeType, T_ConnectionType>::AddConnectionsInDirections(int idx, int col, int row, const vector<Elite::Vector2>& directions)
 	{
 		for (auto d : directions)
 		{
@@ -175,7 +441,7 @@ namespace Elite
 
 				if (IsUniqueConnection(idx, neighborIdx) 
 					&& connectionCost < 100000) //Extra check for different terrain types
-					AddConnection(new GraphConnection(idx, neighborIdx, connectionCost));
+					AddConnection(idx, neighborIdx, connectionCost);
 			}
 		}
 	}
@@ -216,6 +482,444 @@ namespace Elite
 		return cost;
 	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	inline int GridGraph<T_NodeType, T_ConnectionType>::GetCellTerrainCost(int) const
+	{
+		return 1;
+	}
+
+	template<>
+	inline int GridGraph<GridTerrainNode, GraphConnection>::GetCellTerrainCost(int idx) const
+	{
+		return int(GetNode(idx)->GetTerrainType());
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	bool GridGraph<T_NodeType, T_ConnectionType>::UpdateCell(int idx, bool isIsolated)
+	{
+		const bool wasWalkable{ IsWalkable(idx) };
+		const uint8_t oldTerrainCost{ m_CellTerrainCosts[idx] };
+		if (wasWalkable && oldTerrainCost != 1)
+			--m_NrOfCostlyCells;
+
+		int terrainCost{ GetCellTerrainCost(idx) };
+		m_CellTerrainCosts[idx] = uint8_t((terrainCost < 255) ? terrainCost : 255);
+		SetWalkable(idx, !isIsolated && terrainCost < int(TerrainType::Wall));
+
+		if (IsWalkable(idx) && m_CellTerrainCosts[idx] != 1)
+			++m_NrOfCostlyCells;
+
+		return IsWalkable(idx) != wasWalkable || m_CellTerrainCosts[idx] != oldTerrainCost;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::RecordChange(int idx)
+	{
+		if (m_ChangedCells.size() == MaxJournalSize)
+		{
+			m_ChangedCells.erase(m_ChangedCells.begin(), m_ChangedCells.begin() + MaxJournalSize / 2);
+			m_FirstJournalVersion += MaxJournalSize / 2;
+		}
+
+		m_ChangedCells.push_back(idx);
+		++m_Version;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	bool GridGraph<T_NodeType, T_ConnectionType>::GetChangedCells(unsigned int sinceVersion, vector<int>& changedCells) const
+	{
+		if (sinceVersion < m_FirstJournalVersion)
+			return false;
+
+		changedCells.insert(changedCells.end(), m_ChangedCells.begin() + (sinceVersion - m_FirstJournalVersion), m_ChangedCells.end());
+		return true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::SetWalkable(int idx, bool isWalkable)
+	{
+		uint64_t bit{ uint64_t(1) << (idx & 63) };
+		int transposedIdx{ (idx % m_NrOfColumns) * m_NrOfRows + idx / m_NrOfColumns };
+		uint64_t transposedBit{ uint64_t(1) << (transposedIdx & 63) };
+		if (isWalkable)
+		{
+			m_WalkableCells[idx >> 6] |= bit;
+			m_WalkableCellsTransposed[transposedIdx >> 6] |= transposedBit;
+		}
+		else
+		{
+			m_WalkableCells[idx >> 6] &= ~bit;
+			m_WalkableCellsTransposed[transposedIdx >> 6] &= ~transposedBit;
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline bool GridGraph<T_NodeType, T_ConnectionType>::IsRowRunWalkable(int row, int firstCol, int lastCol) const
+	{
+		return AreAllBitsSet(m_WalkableCells, row * m_NrOfColumns + firstCol, row * m_NrOfColumns + lastCol);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline bool GridGraph<T_NodeType, T_ConnectionType>::IsColumnRunWalkable(int col, int firstRow, int lastRow) const
+	{
+		return AreAllBitsSet(m_WalkableCellsTransposed, col * m_NrOfRows + firstRow, col * m_NrOfRows + lastRow);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline bool GridGraph<T_NodeType, T_ConnectionType>::AreAllBitsSet(const vector<uint64_t>& bits, int firstBit, int lastBit)
+	{
+		const int firstWord{ firstBit >> 6 };
+		const int lastWord{ lastBit >> 6 };
+		const uint64_t firstMask{ ~uint64_t(0) << (firstBit & 63) };
+		const uint64_t lastMask{ ~uint64_t(0) >> (63 - (lastBit & 63)) };
+
+		if (firstWord == lastWord)
+			return (bits[firstWord] & (firstMask & lastMask)) == (firstMask & lastMask);
+
+		if ((bits[firstWord] & firstMask) != firstMask)
+			return false;
+
+		for (int word = firstWord + 1; word < lastWord; ++word)
+		{
+			if (bits[word] != ~uint64_t(0))
+				return false;
+		}
+
+		return (bits[lastWord] & lastMask) == lastMask;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	int GridGraph<T_NodeType, T_ConnectionType>::GetClosestConnectedCell(int fromIdx, int toIdx) const
+	{
+		const int label{ m_ComponentLabels[fromIdx] };
+		if (label == invalid_node_index)
+			return fromIdx;
+		if (m_ComponentLabels[toIdx] == label)
+			return toIdx;
+
+		//Visit the square rings around the target cell, every cell of ring r is at least r away from it
+		//so the rings stop once they can't hold a closer cell than the closest one found
+		const int col{ toIdx % m_NrOfColumns };
+		const int row{ toIdx / m_NrOfColumns };
+		int closestIdx{ fromIdx };
+		int closestDistanceSq{ (std::numeric_limits<int>::max)() };
+		auto visitCell = [&](int c, int r)
+		{
+			const int idx{ GetIndex(c, r) };
+			const int distanceSq{ (c - col) * (c - col) + (r - row) * (r - row) };
+			if (m_ComponentLabels[idx] == label && distanceSq < closestDistanceSq)
+			{
+				closestDistanceSq = distanceSq;
+				closestIdx = idx;
+			}
+		};
+
+		const int maxRadius{ (m_NrOfColumns > m_NrOfRows) ? m_NrOfColumns : m_NrOfRows };
+		for (int radius{ 1 }; radius < maxRadius && radius * radius < closestDistanceSq; ++radius)
+		{
+			const int firstCol{ (col - radius > 0) ? col - radius : 0 };
+			const int lastCol{ (col + radius < m_NrOfColumns) ? col + radius : m_NrOfColumns - 1 };
+			const int firstRow{ (row - radius > 0) ? row - radius : 0 };
+			const int lastRow{ (row + radius < m_NrOfRows) ? row + radius : m_NrOfRows - 1 };
+			for (int r{ firstRow }; r <= lastRow; ++r)
+			{
+				//The top and bottom row of the ring are whole, the rows in between only have their two ends
+				if (r == row - radius || r == row + radius)
+				{
+					for (int c{ firstCol }; c <= lastCol; ++c)
+						visitCell(c, r);
+					continue;
+				}
+
+				if (col - radius >= 0)
+					visitCell(col - radius, r);
+				if (col + radius < m_NrOfColumns)
+					visitCell(col + radius, r);
+			}
+		}
+
+		return closestIdx;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	GraphMemoryStatistics GridGraph<T_NodeType, T_ConnectionType>::GetMemoryStatistics() const
+	{
+		GraphMemoryStatistics statistics{ IGraph::GetMemoryStatistics() };
+		statistics.nodes += m_NodeStorage.capacity() * sizeof(T_NodeType);
+
+		statistics.cells = (m_WalkableCells.capacity() + m_WalkableCellsTransposed.capacity()) * sizeof(uint64_t)
+			+ m_CellTerrainCosts.capacity() * sizeof(uint8_t)
+			+ m_ChangedCells.capacity() * sizeof(int)
+			+ (m_ComponentLabels.capacity() + m_ComponentSizes.capacity() + m_FreeComponentLabels.capacity() + m_ComponentQueue.capacity()) * sizeof(int)
+			+ m_SplitVisits.capacity() * sizeof(unsigned int);
+		for (const vector<int>& splitQueue : m_SplitQueues)
+			statistics.cells += splitQueue.capacity() * sizeof(int);
+
+		return statistics;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	template<typename T_Function>
+	inline void GridGraph<T_NodeType, T_ConnectionType>::ForEachWalkableCell(int idx, T_Function&& function) const
+	{
+		ForEachAdjacentCell(idx, [&](int neighborIdx)
+		{
+			if (IsWalkable(neighborIdx))
+				function(neighborIdx);
+		});
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	template<typename T_Function>
+	inline void GridGraph<T_NodeType, T_ConnectionType>::ForEachAdjacentCell(int idx, T_Function&& function) const
+	{
+		static const int directionCols[8]{ 1, 0, -1, 0, 1, -1, -1, 1 };
+		static const int directionRows[8]{ 0, 1, 0, -1, 1, 1, -1, -1 };
+
+		const int col{ idx % m_NrOfColumns };
+		const int row{ idx / m_NrOfColumns };
+		const int nrOfDirections{ m_IsConnectedDiagionally ? 8 : 4 };
+		for (int d{ 0 }; d < nrOfDirections; ++d)
+		{
+			const int neighborCol{ col + directionCols[d] };
+			const int neighborRow{ row + directionRows[d] };
+			if (IsWithinBounds(neighborCol, neighborRow))
+				function(GetIndex(neighborCol, neighborRow));
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::BuildComponents()
+	{
+		const int nrOfCells{ m_NrOfColumns * m_NrOfRows };
+		m_ComponentLabels.assign(nrOfCells, invalid_node_index);
+		m_ComponentSizes.clear();
+		m_FreeComponentLabels.clear();
+		m_SplitQueues.resize(MaxNrOfSplitSearches);
+		m_SplitVisits.assign(nrOfCells, 0);
+		m_SplitId = 0;
+
+		for (int idx = 0; idx < nrOfCells; ++idx)
+		{
+			if (IsWalkable(idx) && m_ComponentLabels[idx] == invalid_node_index)
+				RelabelComponent(idx, CreateComponent());
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::AddToComponents(int idx)
+	{
+		//The largest component next to the cell keeps its label, the cells of the others get that label as well
+		int largestLabel{ invalid_node_index };
+		ForEachWalkableCell(idx, [&](int neighborIdx)
+		{
+			const int label{ m_ComponentLabels[neighborIdx] };
+			if (largestLabel == invalid_node_index || m_ComponentSizes[label] > m_ComponentSizes[largestLabel])
+				largestLabel = label;
+		});
+
+		if (largestLabel == invalid_node_index)
+			largestLabel = CreateComponent();
+
+		m_ComponentLabels[idx] = largestLabel;
+		++m_ComponentSizes[largestLabel];
+		ForEachWalkableCell(idx, [&](int neighborIdx)
+		{
+			if (m_ComponentLabels[neighborIdx] != largestLabel)
+				RelabelComponent(neighborIdx, largestLabel);
+		});
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::RemoveFromComponents(int idx)
+	{
+		const int label{ m_ComponentLabels[idx] };
+		m_ComponentLabels[idx] = invalid_node_index;
+		if (--m_ComponentSizes[label] == 0)
+		{
+			m_FreeComponentLabels.push_back(label);
+			return;
+		}
+
+		//Group the walkable cells around the cell by how they connect to each other without it, a path through the cell can always go around it
+		//within such a group. The diagonal cells are part of the ring even without diagonal connections, they can link two straight neighbors
+		const int col{ idx % m_NrOfColumns };
+		const int row{ idx / m_NrOfColumns };
+		int ringCells[8];
+		bool isNeighbor[8];
+		int ringGroups[8];
+		int nrOfRingCells{ 0 };
+		for (int r{ row - 1 }; r <= row + 1; ++r)
+		{
+			for (int c{ col - 1 }; c <= col + 1; ++c)
+			{
+				if ((c == col && r == row) || !IsWithinBounds(c, r) || !IsWalkable(GetIndex(c, r)))
+					continue;
+
+				ringCells[nrOfRingCells] = GetIndex(c, r);
+				isNeighbor[nrOfRingCells] = m_IsConnectedDiagionally || c == col || r == row;
+				ringGroups[nrOfRingCells] = nrOfRingCells;
+				++nrOfRingCells;
+			}
+		}
+
+		auto findGroup = [](int* groups, int i)
+		{
+			while (groups[i] != i)
+				i = groups[i];
+			return i;
+		};
+
+		for (int i{ 0 }; i < nrOfRingCells; ++i)
+		{
+			for (int j{ i + 1 }; j < nrOfRingCells; ++j)
+			{
+				const int colDistance{ abs(ringCells[i] % m_NrOfColumns - ringCells[j] % m_NrOfColumns) };
+				const int rowDistance{ abs(ringCells[i] / m_NrOfColumns - ringCells[j] / m_NrOfColumns) };
+				const bool isAdjacent{ m_IsConnectedDiagionally ? (colDistance <= 1 && rowDistance <= 1) : (colDistance + rowDistance == 1) };
+				if (isAdjacent)
+					ringGroups[findGroup(ringGroups, j)] = findGroup(ringGroups, i);
+			}
+		}
+
+		//One neighbor of every group starts a search
+		int seeds[MaxNrOfSplitSearches];
+		int nrOfSeeds{ 0 };
+		for (int i{ 0 }; i < nrOfRingCells; ++i)
+		{
+			if (!isNeighbor[i])
+				continue;
+
+			bool hasSeed{ false };
+			for (int j{ 0 }; j < i && !hasSeed; ++j)
+				hasSeed = isNeighbor[j] && findGroup(ringGroups, j) == findGroup(ringGroups, i);
+			if (!hasSeed)
+				seeds[nrOfSeeds++] = ringCells[i];
+		}
+
+		if (nrOfSeeds <= 1)
+			return;
+
+		//Flood from every group at the same pace. Searches that meet are merged, a search that runs out of cells found a part of its own.
+		//Once a single search is left, it keeps the label and the work done is bounded by the size of the smaller parts
+		if (++m_SplitId >= (std::numeric_limits<unsigned int>::max)() / MaxNrOfSplitSearches)
+		{
+			m_SplitVisits.assign(m_SplitVisits.size(), 0);
+			m_SplitId = 1;
+		}
+
+		const unsigned int firstVisit{ m_SplitId * MaxNrOfSplitSearches };
+		int searchGroups[MaxNrOfSplitSearches];
+		size_t nrOfExpandedCells[MaxNrOfSplitSearches];
+		bool isPart[MaxNrOfSplitSearches];
+		for (int search{ 0 }; search < nrOfSeeds; ++search)
+		{
+			m_SplitQueues[search].clear();
+			m_SplitQueues[search].push_back(seeds[search]);
+			m_SplitVisits[seeds[search]] = firstVisit + search;
+			searchGroups[search] = search;
+			nrOfExpandedCells[search] = 0;
+			isPart[search] = false;
+		}
+
+		int nrOfOpenGroups{ nrOfSeeds };
+		while (nrOfOpenGroups > 1)
+		{
+			for (int search{ 0 }; search < nrOfSeeds && nrOfOpenGroups > 1; ++search)
+			{
+				vector<int>& queue{ m_SplitQueues[search] };
+				if (nrOfExpandedCells[search] == queue.size())
+					continue;
+
+				const int currentIdx{ queue[nrOfExpandedCells[search]++] };
+				ForEachWalkableCell(currentIdx, [&](int neighborIdx)
+				{
+					const unsigned int visit{ m_SplitVisits[neighborIdx] };
+					if (visit < firstVisit)
+					{
+						m_SplitVisits[neighborIdx] = firstVisit + search;
+						queue.push_back(neighborIdx);
+						return;
+					}
+
+					const int group{ findGroup(searchGroups, search) };
+					const int otherGroup{ findGroup(searchGroups, int(visit - firstVisit)) };
+					if (group != otherGroup)
+					{
+						searchGroups[otherGroup] = group;
+						--nrOfOpenGroups;
+					}
+				});
+			}
+
+			for (int group{ 0 }; group < nrOfSeeds && nrOfOpenGroups > 1; ++group)
+			{
+				if (isPart[group] || findGroup(searchGroups, group) != group)
+					continue;
+
+				bool isExhausted{ true };
+				for (int search{ 0 }; search < nrOfSeeds && isExhausted; ++search)
+					isExhausted = findGroup(searchGroups, search) != group || nrOfExpandedCells[search] == m_SplitQueues[search].size();
+				if (!isExhausted)
+					continue;
+
+				const int newLabel{ CreateComponent() };
+				for (int search{ 0 }; search < nrOfSeeds; ++search)
+				{
+					if (findGroup(searchGroups, search) != group)
+						continue;
+
+					for (int cellIdx : m_SplitQueues[search])
+						m_ComponentLabels[cellIdx] = newLabel;
+					m_ComponentSizes[newLabel] += int(m_SplitQueues[search].size());
+					m_ComponentSizes[label] -= int(m_SplitQueues[search].size());
+				}
+
+				isPart[group] = true;
+				--nrOfOpenGroups;
+			}
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	int GridGraph<T_NodeType, T_ConnectionType>::CreateComponent()
+	{
+		if (m_FreeComponentLabels.empty())
+		{
+			m_ComponentSizes.push_back(0);
+			return int(m_ComponentSizes.size()) - 1;
+		}
+
+		const int label{ m_FreeComponentLabels.back() };
+		m_FreeComponentLabels.pop_back();
+		return label;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void GridGraph<T_NodeType, T_ConnectionType>::RelabelComponent(int startIdx, int newLabel)
+	{
+		const int oldLabel{ m_ComponentLabels[startIdx] };
+		m_ComponentQueue.clear();
+		m_ComponentQueue.push_back(startIdx);
+		m_ComponentLabels[startIdx] = newLabel;
+		for (size_t i{ 0 }; i < m_ComponentQueue.size(); ++i)
+		{
+			ForEachWalkableCell(m_ComponentQueue[i], [&](int neighborIdx)
+			{
+				if (m_ComponentLabels[neighborIdx] != oldLabel)
+					return;
+
+				m_ComponentLabels[neighborIdx] = newLabel;
+				m_ComponentQueue.push_back(neighborIdx);
+			});
+		}
+
+		const int nrOfCells{ int(m_ComponentQueue.size()) };
+		m_ComponentSizes[newLabel] += nrOfCells;
+		if (oldLabel != invalid_node_index && (m_ComponentSizes[oldLabel] -= nrOfCells) == 0)
+			m_FreeComponentLabels.push_back(oldLabel);
+	}
+
 	template<class T_NodeType, class T_ConnectionType>
 	Elite::Vector2 GridGraph<T_NodeType, T_ConnectionType>::GetNodePos(T_NodeType* pNode) const
 	{
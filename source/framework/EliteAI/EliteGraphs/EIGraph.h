@@ -9,17 +9,32 @@
 
 #include "EGraphNodeTypes.h"
 #include "EGraphConnectionTypes.h"
+#include "EGraphSlabPool.h"
 #include <memory>
 
 namespace Elite
 {
+	//Memory held by a graph, in bytes
+	struct GraphMemoryStatistics
+	{
+		size_t nodes = 0; // node objects the graph owns and the node pointers
+		size_t connections = 0; // slabs of the connection pool, free slots included
+		size_t connectionLists = 0; // the adjacency lists
+		size_t compactConnections = 0; // compressed adjacency
+		size_t cells = 0; // per cell data of grid graphs
+		int nrOfConnections = 0;
+		int nrOfFreeConnectionSlots = 0; // slots of removed connections, reused by the next connections added
+
+		size_t GetTotal() const { return nodes + connections + connectionLists + compactConnections + cells; }
+	};
+
 	template <class T_NodeType, class T_ConnectionType>
 	class IGraph
 	{
 	public:
 		// shorthand typedefs
 		using NodeVector = std::vector<T_NodeType*>;
-		using ConnectionList = std::list<T_ConnectionType*>; // TODO: function definition doesn't recognize this?
+		using ConnectionList = std::vector<T_ConnectionType*>; // one block per node instead of an allocation per connection
 		using ConnectionListVector = std::vector<ConnectionList>;
 
 	public:
@@ -40,11 +55,18 @@ namespace Elite
 		const ConnectionListVector& GetAllConnections() const { return m_Connections; }
 		const ConnectionList& GetNodeConnections(int idx) const;
 
+		// Calls function(int to, float cost) for every connection leaving the node, iterating the compressed adjacency
+		template<typename T_Function>
+		void ForEachNeighbor(int idx, T_Function&& function) const;
+		// Makes sure the compressed adjacency is up to date, call this before searching the graph from multiple threads
+		void EnsureCompactConnections() const;
+
 		int GetNextFreeNodeIndex() const { return m_NextNodeIndex; }
 		int AddNode(T_NodeType* pNode);
 		void RemoveNode(int node);
 
-		void AddConnection(T_ConnectionType* pConnection);
+		// Creates the connection in the connection pool of the graph, use GetConnection to get to it afterwards
+		void AddConnection(int from, int to, float cost);
 		void RemoveConnection(int from, int to);
 		void RemoveConnection(T_ConnectionType* pConnection);
 
@@ -59,9 +81,12 @@ namespace Elite
 		bool IsDirectionalGraph() const { return m_IsDirectionalGraph; }
 		bool IsEmpty() const { return m_Nodes.empty(); }
 
+		// Both destroy the connections (and the nodes the graph owns) they remove
 		void Clear();
 		void RemoveConnections();
 
+		virtual GraphMemoryStatistics GetMemoryStatistics() const;
+
 		IGraph GetMST() const;
 
 		// Visualization
@@ -84,61 +109,85 @@ namespace Elite
 
 		bool m_IsDirectionalGraph;
 
+		// Every node gets room for at least this many compact connections when the compressed adjacency is rebuilt,
+		// connections added later on can then be patched in without a rebuild
+		int m_CompactMinCapacity;
+
+		// Set by graphs that compute their connections on the fly (see GridGraph), before any node is added
+		// No connection lists or connection objects are stored then, the derived graph hides ForEachNeighbor
+		bool m_HasImplicitConnections;
+
+		// Cleared by graphs that keep their nodes themselves (see GridGraph), the graph deletes its nodes otherwise
+		bool m_OwnsNodes;
+
 		// protected functions
 		bool IsUniqueConnection(int from, int to) const;
+		// adds a connection of the connection pool, and its opposite connection in an undirected graph
+		void AddPooledConnection(T_ConnectionType* pConnection);
+		// Bulk construction for graphs without connections yet: the connections of node i are connections[i * stride, ends[i][ (to, cost)
+		// They are added as they are, without checking for duplicates or opposite connections, and become the compressed adjacency
+		void AddConnections(std::vector<CompactConnection>&& connections, int stride, std::vector<int>&& ends);
+		void DeleteNodes();
 
 	private:
 		int m_NextNodeIndex;
 
+		// Every connection of the graph lives in here, removed connections give their slot to the next one
+		SlabPool<T_ConnectionType> m_ConnectionPool;
+
+		// Compressed sparse row copy of m_Connections: the connections of node i are stored in
+		// m_CompactConnections[m_CompactOffsets[i], m_CompactEnds[i][, the slots up to m_CompactOffsets[i + 1] are free
+		// The copy is rebuilt lazily after structural changes, connection changes are patched in place when possible
+		mutable std::vector<CompactConnection> m_CompactConnections;
+		mutable std::vector<int> m_CompactOffsets;
+		mutable std::vector<int> m_CompactEnds;
+		mutable bool m_IsCompactDirty;
+
 		// private functions
 		void CullInvalidEdges();
+		void RebuildCompactConnections() const;
+		void AddCompactConnection(int from, int to, float cost);
+		void RemoveCompactConnection(int from, int to);
 	};
 
 	template<class T_NodeType, class T_ConnectionType>
 	inline IGraph<T_NodeType, T_ConnectionType>::IGraph(bool isDirectionalGraph)
 		: m_NextNodeIndex(0)
 		, m_IsDirectionalGraph(isDirectionalGraph)
+		, m_CompactMinCapacity(0)
+		, m_HasImplicitConnections(false)
+		, m_OwnsNodes(true)
+		, m_IsCompactDirty(true)
 	{
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
 	inline IGraph<T_NodeType, T_ConnectionType>::IGraph(const IGraph& other)
 	{
-		for (auto& n : m_Nodes)
-			SAFE_DELETE(n);
-
-		for (auto& connectionList : m_Connections)
-		{
-			for (auto& connection : connectionList)
-				SAFE_DELETE(connection);
-		};
-
 		for (auto n : other.m_Nodes)
 			m_Nodes.push_back(new T_NodeType(*n));
 
-		for (auto cList : other.m_Connections)
+		for (auto& cList : other.m_Connections)
 		{
 			ConnectionList newList;
 			for (auto c : cList)
-				newList.push_back(new T_ConnectionType(*c));
-			m_Connections.push_back(newList);
+				newList.push_back(m_ConnectionPool.Create(*c));
+			m_Connections.push_back(std::move(newList));
 		}
 
 		m_IsDirectionalGraph = other.m_IsDirectionalGraph;
 		m_NextNodeIndex = other.m_NextNodeIndex;
+		m_CompactMinCapacity = other.m_CompactMinCapacity;
+		m_HasImplicitConnections = other.m_HasImplicitConnections;
+		m_OwnsNodes = true;
+		m_IsCompactDirty = true;
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
 	inline IGraph<T_NodeType, T_ConnectionType>::~IGraph()
 	{
-		for(auto& n : m_Nodes)
-			SAFE_DELETE(n);
-
-		for(auto& connectionList : m_Connections)
-		{
-			for (auto& connection : connectionList)
-				SAFE_DELETE(connection);
-		}
+		// the connection pool releases the connections in one go
+		DeleteNodes();
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -168,6 +217,9 @@ namespace Elite
 			m_Nodes[to]->GetIndex() != invalid_node_index &&
 			"<Graph::GetConnection>: invalid 'to' index");
 
+		if (m_HasImplicitConnections)
+			return nullptr;
+
 		for (auto c : m_Connections[from])
 		{
 			if (c && c->GetTo() == to)
@@ -189,13 +241,40 @@ namespace Elite
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
-	inline const std::list<T_ConnectionType*>& IGraph<T_NodeType, T_ConnectionType>::GetNodeConnections(int idx) const
+	inline const typename IGraph<T_NodeType, T_ConnectionType>::ConnectionList& IGraph<T_NodeType, T_ConnectionType>::GetNodeConnections(int idx) const
 	{
 		assert((idx < (int)m_Nodes.size()) && (idx >= 0) && "<Graph::GetNode>: invalid index");
 
+		static const ConnectionList noConnections{};
+		if (m_HasImplicitConnections)
+			return noConnections;
+
 		return m_Connections[idx];
 	}
 
+	template<class T_NodeType, class T_ConnectionType>
+	template<typename T_Function>
+	inline void IGraph<T_NodeType, T_ConnectionType>::ForEachNeighbor(int idx, T_Function&& function) const
+	{
+		assert((idx < (int)m_Nodes.size()) && (idx >= 0) && "<Graph::ForEachNeighbor>: invalid index");
+		assert(!m_HasImplicitConnections && "<Graph::ForEachNeighbor>: implicit graphs provide their own neighbors");
+
+		if (m_IsCompactDirty)
+			RebuildCompactConnections();
+
+		const CompactConnection* pConnection{ m_CompactConnections.data() + m_CompactOffsets[idx] };
+		const CompactConnection* pEnd{ m_CompactConnections.data() + m_CompactEnds[idx] };
+		for (; pConnection != pEnd; ++pConnection)
+			function(pConnection->to, pConnection->cost);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::EnsureCompactConnections() const
+	{
+		if (m_IsCompactDirty && !m_HasImplicitConnections)
+			RebuildCompactConnections();
+	}
+
 	template<class T_NodeType, class T_ConnectionType>
 	inline int IGraph<T_NodeType, T_ConnectionType>::AddNode(T_NodeType* pNode)
 	{
@@ -207,6 +286,7 @@ namespace Elite
 				"<Graph::AddNode>: Attempting to add a node with a duplicate ID");
 
 			m_Nodes[pNode->GetIndex()] = pNode;
+			m_IsCompactDirty = true;
 
 			return m_NextNodeIndex;
 		}
@@ -216,7 +296,9 @@ namespace Elite
 			assert(pNode->GetIndex() == m_NextNodeIndex && "<Graph::AddNode>:invalid index");
 
 			m_Nodes.push_back(pNode);
-			m_Connections.push_back(ConnectionList());
+			if (!m_HasImplicitConnections)
+				m_Connections.push_back(ConnectionList());
+			m_IsCompactDirty = true;
 
 			return m_NextNodeIndex++;
 		}
@@ -232,10 +314,11 @@ namespace Elite
 
 		//set this pNode's index to invalid_node_index
 		m_Nodes[node]->SetIndex(invalid_node_index);
+		m_IsCompactDirty = true;
 
 		//if the graph is not directed remove all connections leading to this pNode and then
 		//clear the connections leading from the pNode
-		if (!m_IsDirectionalGraph)
+		if (!m_IsDirectionalGraph && !m_HasImplicitConnections)
 		{
 			//visit each neighbour and erase any connections leading to this pNode
 			for (auto currentConnection = m_Connections[node].begin();
@@ -250,7 +333,7 @@ namespace Elite
 					{
 						auto conPtr = *currentEdgeOnToNode;
 						currentEdgeOnToNode = m_Connections[(*currentConnection)->GetTo()].erase(currentEdgeOnToNode);
-						SAFE_DELETE(conPtr);
+						m_ConnectionPool.Destroy(conPtr);
 
 						break;
 					}
@@ -258,18 +341,25 @@ namespace Elite
 			}
 
 			//finally, clear this pNode's connections
-			for (auto& connection : m_Connections[node])
-					SAFE_DELETE(connection);
+			for (auto connection : m_Connections[node])
+				m_ConnectionPool.Destroy(connection);
 			m_Connections[node].clear();
 		}
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
-	inline void IGraph<T_NodeType, T_ConnectionType>::AddConnection(T_ConnectionType* pConnection)
+	inline void IGraph<T_NodeType, T_ConnectionType>::AddConnection(int from, int to, float cost)
+	{
+		AddPooledConnection(m_ConnectionPool.Create(from, to, cost));
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::AddPooledConnection(T_ConnectionType* pConnection)
 	{
 		//first make sure the from and to nodes exist within the graph 
 		assert((pConnection->GetFrom() < m_NextNodeIndex) && (pConnection->GetTo() < m_NextNodeIndex) && (pConnection->GetTo() != pConnection->GetFrom()) &&
 			"<Graph::AddConnection>: invalid node index");
+		assert(!m_HasImplicitConnections && "<Graph::AddConnection>: graph has implicit connections");
 
 		//make sure both nodes are active before adding the pConnection
 		if ((m_Nodes[pConnection->GetTo()]->GetIndex() != invalid_node_index) &&
@@ -279,6 +369,7 @@ namespace Elite
 			assert(IsUniqueConnection(pConnection->GetFrom(), pConnection->GetTo()) && "Connection already exists on this graph");
 			
 			m_Connections[pConnection->GetFrom()].push_back(pConnection);
+			AddCompactConnection(pConnection->GetFrom(), pConnection->GetTo(), pConnection->GetCost());
 
 			//if the graph is undirected we must add another pConnection in the opposite
 			//direction
@@ -287,17 +378,44 @@ namespace Elite
 				//check to make sure the pConnection is unique before adding
 				if (IsUniqueConnection(pConnection->GetTo(), pConnection->GetFrom()))
 				{
-					T_ConnectionType* oppositeDirEdge = new T_ConnectionType();
+					T_ConnectionType* oppositeDirEdge = m_ConnectionPool.Create(*pConnection);
 
-					oppositeDirEdge->SetCost(pConnection->GetCost());
 					oppositeDirEdge->SetTo(pConnection->GetFrom());
 					oppositeDirEdge->SetFrom(pConnection->GetTo());
 
 					m_Connections[pConnection->GetTo()].push_back(oppositeDirEdge);
+					AddCompactConnection(oppositeDirEdge->GetFrom(), oppositeDirEdge->GetTo(), oppositeDirEdge->GetCost());
 				}
 			}
 		}
-		
+		else
+		{
+			m_ConnectionPool.Destroy(pConnection);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::AddConnections(std::vector<CompactConnection>&& connections, int stride, std::vector<int>&& ends)
+	{
+		const int nrOfNodes{ int(m_Nodes.size()) };
+		assert(m_ConnectionPool.GetStatistics().nrOfObjects == 0 && "<Graph::AddConnections>: graph has connections already");
+		assert(int(connections.size()) == nrOfNodes * stride && int(ends.size()) == nrOfNodes && "<Graph::AddConnections>: invalid connections");
+		assert(!m_HasImplicitConnections && "<Graph::AddConnections>: graph has implicit connections");
+
+		for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+		{
+			m_Connections[idx].reserve(ends[idx] - idx * stride);
+			for (int c{ idx * stride }; c < ends[idx]; ++c)
+				m_Connections[idx].push_back(m_ConnectionPool.Create(idx, connections[c].to, connections[c].cost));
+		}
+
+		//the connections are laid out like the compressed adjacency already, with room for stride connections per node
+		m_CompactConnections = std::move(connections);
+		m_CompactEnds = std::move(ends);
+		m_CompactOffsets.resize(nrOfNodes + 1);
+		for (int idx{ 0 }; idx <= nrOfNodes; ++idx)
+			m_CompactOffsets[idx] = idx * stride;
+		m_IsCompactDirty = false;
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -305,6 +423,7 @@ namespace Elite
 	{
 		assert((from < (int)m_Nodes.size()) && (to < (int)m_Nodes.size()) &&
 			"<Graph::RemoveConnection>:invalid node index");
+		assert(!m_HasImplicitConnections && "<Graph::RemoveConnection>: graph has implicit connections");
 
 		auto conFromTo = GetConnection(from, to);
 		auto conToFrom = GetConnection(to, from);
@@ -321,6 +440,8 @@ namespace Elite
 					break; 
 				}
 			}
+
+			RemoveCompactConnection(to, from);
 		}
 
 		for (auto curEdge = m_Connections[from].begin();
@@ -334,8 +455,11 @@ namespace Elite
 			}
 		}
 
-		SAFE_DELETE(conFromTo);
-		SAFE_DELETE(conToFrom);
+		RemoveCompactConnection(from, to);
+
+		m_ConnectionPool.Destroy(conFromTo);
+		if (!m_IsDirectionalGraph)
+			m_ConnectionPool.Destroy(conToFrom);
 
 	}
 
@@ -348,19 +472,40 @@ namespace Elite
 	template<class T_NodeType, class T_ConnectionType>
 	inline void IGraph<T_NodeType, T_ConnectionType>::IsolateNode(int idx)
 	{
+		assert(!m_HasImplicitConnections && "<Graph::IsolateNode>: graph has implicit connections");
+
 		// remove and delete connections from this pNode
+		// in an undirected graph the connections to this pNode mirror them, so only its neighbors have connections to remove
+		auto isConnectionToThisNode = [idx](T_ConnectionType* pCon) { return pCon->GetTo() == idx; };
 		for (auto c : m_Connections[idx])
-			delete c;
+		{
+			if (!m_IsDirectionalGraph)
+			{
+				ConnectionList& neighborConnections{ m_Connections[c->GetTo()] };
+				auto foundIt = std::find_if(neighborConnections.begin(), neighborConnections.end(), isConnectionToThisNode);
+				if (foundIt != neighborConnections.end())
+				{
+					m_ConnectionPool.Destroy(*foundIt);
+					neighborConnections.erase(foundIt);
+				}
+				RemoveCompactConnection(c->GetTo(), idx);
+			}
+			RemoveCompactConnection(idx, c->GetTo());
+			m_ConnectionPool.Destroy(c);
+		}
 		m_Connections[idx].clear();
 
-		// remove and delete connections from other nodes to this pNode
-		auto isConnectionToThisNode = [idx](T_ConnectionType* pCon) { return pCon->GetTo() == idx; };
+		if (!m_IsDirectionalGraph)
+			return;
+
+		// any node of a directed graph can have a connection to this pNode, remove and delete those
+		m_IsCompactDirty = true;
 		for (auto& c : m_Connections)
 		{
-			list<T_ConnectionType*>::iterator foundIt;
+			typename ConnectionList::iterator foundIt;
 			while ((foundIt = std::find_if(c.begin(), c.end(), isConnectionToThisNode))	!= c.end())
 			{
-				delete *foundIt;
+				m_ConnectionPool.Destroy(*foundIt);
 				c.erase(foundIt);
 			}
 		}
@@ -372,11 +517,10 @@ namespace Elite
 		//make sure the nodes given are valid
 		assert((from < (int)m_Nodes.size()) && (to < (int)m_Nodes.size()) &&
 			"<Graph::SetEdgeCost>: invalid index");
+		assert(!m_HasImplicitConnections && "<Graph::SetEdgeCost>: graph has implicit connections");
 
-		//visit each neighbour and erase any connections leading to this pNode
-		for (auto& curEdge = m_Connections[from].begin();
-			curEdge != m_Connections[from].end();
-			++curEdge)
+		//find the connection and update its cost
+		for (auto curEdge : m_Connections[from])
 		{
 			if (curEdge->GetTo() == to)
 			{
@@ -384,6 +528,18 @@ namespace Elite
 				break;
 			}
 		}
+
+		if (!m_IsCompactDirty)
+		{
+			for (int c{ m_CompactOffsets[from] }; c < m_CompactEnds[from]; ++c)
+			{
+				if (m_CompactConnections[c].to == to)
+				{
+					m_CompactConnections[c].cost = cost;
+					break;
+				}
+			}
+		}
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -416,9 +572,12 @@ namespace Elite
 	template<class T_NodeType, class T_ConnectionType>
 	inline void IGraph<T_NodeType, T_ConnectionType>::Clear()
 	{
+		DeleteNodes();
 		m_NextNodeIndex = 0;
 		m_Nodes.clear();
 		m_Connections.clear();
+		m_ConnectionPool.Release();
+		m_IsCompactDirty = true;
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -426,6 +585,41 @@ namespace Elite
 	{
 		for (auto& connectionList : m_Connections)
 			connectionList.clear();
+		m_ConnectionPool.Release();
+		m_IsCompactDirty = true;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::DeleteNodes()
+	{
+		if (!m_OwnsNodes)
+			return;
+
+		for (auto& n : m_Nodes)
+			SAFE_DELETE(n);
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline GraphMemoryStatistics IGraph<T_NodeType, T_ConnectionType>::GetMemoryStatistics() const
+	{
+		GraphMemoryStatistics statistics{};
+		statistics.nodes = m_Nodes.capacity() * sizeof(T_NodeType*);
+		if (m_OwnsNodes)
+			statistics.nodes += m_Nodes.size() * sizeof(T_NodeType);
+
+		const SlabPoolStatistics poolStatistics{ m_ConnectionPool.GetStatistics() };
+		statistics.connections = poolStatistics.nrOfBytes;
+		statistics.nrOfConnections = poolStatistics.nrOfObjects;
+		statistics.nrOfFreeConnectionSlots = poolStatistics.nrOfFreeSlots;
+
+		statistics.connectionLists = m_Connections.capacity() * sizeof(ConnectionList);
+		for (const ConnectionList& connectionList : m_Connections)
+			statistics.connectionLists += connectionList.capacity() * sizeof(T_ConnectionType*);
+
+		statistics.compactConnections = m_CompactConnections.capacity() * sizeof(CompactConnection)
+			+ (m_CompactOffsets.capacity() + m_CompactEnds.capacity()) * sizeof(int);
+
+		return statistics;
 	}
 
 	template<class T_NodeType, class T_ConnectionType>
@@ -492,4 +686,66 @@ namespace Elite
 			}
 		}
 	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::RebuildCompactConnections() const
+	{
+		int nrOfNodes{ int(m_Nodes.size()) };
+		m_CompactOffsets.resize(nrOfNodes + 1);
+		m_CompactEnds.resize(nrOfNodes);
+
+		int nrOfSlots{ 0 };
+		for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+		{
+			m_CompactOffsets[idx] = nrOfSlots;
+			int degree{ int(m_Connections[idx].size()) };
+			nrOfSlots += (degree > m_CompactMinCapacity) ? degree : m_CompactMinCapacity;
+		}
+		m_CompactOffsets[nrOfNodes] = nrOfSlots;
+
+		m_CompactConnections.resize(nrOfSlots);
+		for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+		{
+			int slot{ m_CompactOffsets[idx] };
+			for (auto c : m_Connections[idx])
+				m_CompactConnections[slot++] = CompactConnection{ c->GetTo(), c->GetCost() };
+
+			m_CompactEnds[idx] = slot;
+		}
+
+		m_IsCompactDirty = false;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::AddCompactConnection(int from, int to, float cost)
+	{
+		if (m_IsCompactDirty)
+			return;
+
+		//no free slot left for this node, the next search rebuilds the whole adjacency
+		if (m_CompactEnds[from] == m_CompactOffsets[from + 1])
+		{
+			m_IsCompactDirty = true;
+			return;
+		}
+
+		m_CompactConnections[m_CompactEnds[from]++] = CompactConnection{ to, cost };
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline void IGraph<T_NodeType, T_ConnectionType>::RemoveCompactConnection(int from, int to)
+	{
+		if (m_IsCompactDirty)
+			return;
+
+		//order of the connections doesn't matter, move the last one in the gap
+		for (int c{ m_CompactOffsets[from] }; c < m_CompactEnds[from]; ++c)
+		{
+			if (m_CompactConnections[c].to == to)
+			{
+				m_CompactConnections[c] = m_CompactConnections[--m_CompactEnds[from]];
+				break;
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -0,0 +1,311 @@
+#pragma once
+#include "SearchContext.h"
+
+namespace Elite
+{
+	//ARA* (Anytime Repairing A*): a first search with the heuristic inflated by epsilon finds a path quickly, its cost is at most epsilon times the cost
+	//of the shortest path. Epsilon then goes down step by step until it reaches 1. Every next search keeps the costs found so far and only opens
+	//the nodes that are on the open list or whose cost improved after they were expanded (the inconsistent nodes), instead of starting over.
+	//The suboptimality bound of the current path is min(epsilon, cost of the path / lowest g + h of the open and inconsistent nodes),
+	//once it reaches 1 the path is optimal.
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap>
+	class ARAStar
+	{
+	public:
+		// the first search inflates the heuristic by initialEpsilon, every next search by epsilonStep less until it reaches 1
+		ARAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, float initialEpsilon = 3.f, float epsilonStep = 0.5f);
+
+		// improves the path until it is optimal or the time budget is used up, the first path is always finished
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// time FindPath may spend on a query, 0 searches until the path is optimal
+		void SetTimeBudget(int maxMicroseconds) { m_TimeBudget = maxMicroseconds; }
+
+		// anytime search over several frames: BeginSearch, then Improve every frame until it no longer returns InProgress, GetPath whenever a path is needed
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// searches until maxMicroseconds passed, returns InProgress until the path is optimal (Found) or the destination turned out unreachable (Failed)
+		SearchStatus Improve(int maxMicroseconds);
+		// the path of the last finished search, or the path to the closest node to the destination while no search finished yet
+		void GetPath(std::vector<T_NodeType*>& path) const;
+		bool HasPath() const { return !m_Path.empty(); }
+
+		float GetEpsilon() const { return m_Epsilon; }
+		// the cost of the current path is at most this many times the cost of the shortest path, FLT_MAX while there is no path
+		float GetSuboptimalityBound() const { return m_SuboptimalityBound; }
+		// counters of all searches of the current query
+		const SearchStatistics& GetStatistics() const { return m_Statistics; }
+
+	private:
+		struct NodeRecord
+		{
+			int parentIdx = invalid_node_index;
+			float costSoFar = FLT_MAX; // g
+			unsigned int closedIteration = 0; // the node is closed in the search of this iteration
+			bool isInconsistent = false; // its cost improved after it was closed, the next search opens it again
+		};
+
+		// nodeIdx is the handle of the record
+		struct OpenRecord
+		{
+			int nodeIdx = invalid_node_index;
+			float estimatedTotalCost = 0.f; // g + epsilon * h
+
+			bool operator<(const OpenRecord& other) const
+			{
+				return estimatedTotalCost < other.estimatedTotalCost;
+			};
+		};
+
+		enum { ClockCheckInterval = 16 };
+
+		// runs the searches until the path is optimal or isOutOfTime(nrOfExpansions) returns true
+		template <class T_Function>
+		SearchStatus Run(T_Function&& isOutOfTime);
+		void ExpandNode();
+		// computes the suboptimality bound of the finished search and prepares the next one, returns true if there is no next one
+		bool FinishIteration();
+		float GetCostSoFar(int nodeIdx) const { return m_Records.Contains(nodeIdx) ? m_Records.Get(nodeIdx).costSoFar : FLT_MAX; }
+		float GetHeuristicCost(int nodeIdx) const;
+		// follows the parents back to the start
+		void TracePath(int lastIdx, std::vector<T_NodeType*>& path) const;
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+		const float m_InitialEpsilon;
+		const float m_EpsilonStep;
+		int m_TimeBudget = 0;
+
+		// state of the query, kept between the calls of Improve
+		NodeRecordTable<NodeRecord> m_Records;
+		T_OpenList<OpenRecord> m_OpenList;
+		std::vector<int> m_InconsistentNodes;
+		std::vector<int> m_IterationNodes; // reused when an iteration ends
+		std::vector<T_NodeType*> m_Path; // found by the last finished search
+		int m_StartIdx = invalid_node_index;
+		int m_DestinationIdx = invalid_node_index; // the closest reachable cell when the destination itself can't be reached
+		bool m_IsDestinationReachable = true;
+		int m_ClosestIdx = invalid_node_index;
+		float m_ClosestHeuristicCost = FLT_MAX;
+		float m_Epsilon = 1.f;
+		float m_SuboptimalityBound = FLT_MAX;
+		unsigned int m_Iteration = 0;
+		SearchStatus m_Status = SearchStatus::Failed;
+		SearchStatistics m_Statistics;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::ARAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, float initialEpsilon, float epsilonStep)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+		, m_InitialEpsilon(initialEpsilon)
+		, m_EpsilonStep(epsilonStep)
+	{
+		assert(initialEpsilon >= 1.f && "<ARAStar>: epsilon can't be lower than 1");
+		assert(epsilonStep > 0.f && "<ARAStar>: epsilon has to go down to reach 1");
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	std::vector<T_NodeType*> ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		BeginSearch(pStartNode, pDestinationNode);
+
+		const auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(m_TimeBudget);
+		Run([this, &endTime](int nrOfExpansions)
+		{
+			return m_TimeBudget > 0 && (nrOfExpansions % ClockCheckInterval) == 0 && HasPath() && std::chrono::high_resolution_clock::now() >= endTime;
+		});
+
+		GetPath(path);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		m_Records.Reset(m_pGraph->GetNrOfNodes());
+		m_OpenList.Clear();
+		m_OpenList.Reserve(m_pGraph->GetNrOfNodes());
+		m_InconsistentNodes.clear();
+		m_Path.clear();
+		m_Statistics = SearchStatistics{};
+		m_StartIdx = pStartNode->GetIndex();
+		m_ClosestIdx = invalid_node_index;
+		m_ClosestHeuristicCost = FLT_MAX;
+		m_Epsilon = m_InitialEpsilon;
+		m_SuboptimalityBound = FLT_MAX;
+		m_Iteration = 1;
+		m_Status = SearchStatus::InProgress;
+
+		//The component labels tell right away if the destination can't be reached, the search runs to the closest cell it can reach then
+		m_IsDestinationReachable = pStartNode == pDestinationNode || m_pGraph->AreConnected(m_StartIdx, pDestinationNode->GetIndex());
+		m_DestinationIdx = m_IsDestinationReachable ? pDestinationNode->GetIndex() : m_pGraph->GetClosestConnectedCell(m_StartIdx, pDestinationNode->GetIndex());
+
+		m_Records.Add(m_StartIdx, NodeRecord{ invalid_node_index, 0.f });
+		m_OpenList.Push(m_StartIdx, OpenRecord{ m_StartIdx, m_Epsilon * GetHeuristicCost(m_StartIdx) });
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	SearchStatus ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::Improve(int maxMicroseconds)
+	{
+		const auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(maxMicroseconds);
+		return Run([&endTime](int nrOfExpansions)
+		{
+			return (nrOfExpansions % ClockCheckInterval) == 0 && std::chrono::high_resolution_clock::now() >= endTime;
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::GetPath(std::vector<T_NodeType*>& path) const
+	{
+		//A search that is improving the parents can make the path through them a bit longer for a while, the path of the finished search keeps its bound
+		if (HasPath())
+			path = m_Path;
+		else
+			TracePath((m_ClosestIdx != invalid_node_index) ? m_ClosestIdx : m_StartIdx, path);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::TracePath(int lastIdx, std::vector<T_NodeType*>& path) const
+	{
+		//Every parent has a lower cost than its child, so the parents lead back to the start even while a search is improving them
+		path.clear();
+		for (int idx{ lastIdx }; idx != invalid_node_index; idx = m_Records.Get(idx).parentIdx)
+			path.push_back(m_pGraph->GetNode(idx));
+		std::reverse(path.begin(), path.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	template <class T_Function>
+	SearchStatus ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::Run(T_Function&& isOutOfTime)
+	{
+		if (m_Status != SearchStatus::InProgress)
+			return m_Status;
+
+		int nrOfExpansions{ 0 };
+		while (true)
+		{
+			//A search ends once no node on the open list can lead to a cheaper path to the destination
+			while (!m_OpenList.Empty() && GetCostSoFar(m_DestinationIdx) > m_OpenList.Top().estimatedTotalCost)
+			{
+				if (isOutOfTime(nrOfExpansions))
+					return SearchStatus::InProgress;
+
+				ExpandNode();
+				++nrOfExpansions;
+			}
+
+			if (FinishIteration())
+				return m_Status;
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::ExpandNode()
+	{
+		const int currentIdx{ m_OpenList.Pop().nodeIdx };
+		m_Records.Get(currentIdx).closedIteration = m_Iteration;
+		++m_Statistics.nrOfExpandedNodes;
+
+		const float heuristicCost{ GetHeuristicCost(currentIdx) };
+		if (heuristicCost < m_ClosestHeuristicCost)
+		{
+			m_ClosestHeuristicCost = heuristicCost;
+			m_ClosestIdx = currentIdx;
+		}
+
+		const float costSoFar{ m_Records.Get(currentIdx).costSoFar };
+		m_pGraph->ForEachNeighbor(currentIdx, [&](int nextIdx, float connectionCost)
+		{
+			if (!m_Records.Contains(nextIdx))
+				m_Records.Add(nextIdx, NodeRecord{});
+
+			NodeRecord& nextRecord{ m_Records.Get(nextIdx) };
+			const float nextCostSoFar{ costSoFar + connectionCost };
+			if (nextCostSoFar >= nextRecord.costSoFar)
+				return;
+
+			nextRecord.costSoFar = nextCostSoFar;
+			nextRecord.parentIdx = currentIdx;
+
+			//A node closed in this search waits for the next one, opening it again now would make the search expand nodes more than once
+			if (nextRecord.closedIteration != m_Iteration)
+			{
+				const OpenRecord openRecord{ nextIdx, nextCostSoFar + m_Epsilon * GetHeuristicCost(nextIdx) };
+				if (m_OpenList.Contains(nextIdx))
+					m_OpenList.DecreaseKey(nextIdx, openRecord);
+				else
+					m_OpenList.Push(nextIdx, openRecord);
+			}
+			else if (!nextRecord.isInconsistent)
+			{
+				nextRecord.isInconsistent = true;
+				m_InconsistentNodes.push_back(nextIdx);
+			}
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	bool ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::FinishIteration()
+	{
+		const float pathCost{ GetCostSoFar(m_DestinationIdx) };
+		if (pathCost == FLT_MAX)
+		{
+			m_Status = SearchStatus::Failed;
+			return true;
+		}
+
+		TracePath(m_DestinationIdx, m_Path);
+
+		//The open and inconsistent nodes are the ones a cheaper path would go through, the lowest g + h among them is a lower bound of the shortest path
+		m_IterationNodes.clear();
+		while (!m_OpenList.Empty())
+			m_IterationNodes.push_back(m_OpenList.Pop().nodeIdx);
+		for (int nodeIdx : m_InconsistentNodes)
+		{
+			m_Records.Get(nodeIdx).isInconsistent = false;
+			m_IterationNodes.push_back(nodeIdx);
+		}
+		m_InconsistentNodes.clear();
+
+		float lowestCost{ FLT_MAX };
+		for (int nodeIdx : m_IterationNodes)
+		{
+			const float cost{ m_Records.Get(nodeIdx).costSoFar + GetHeuristicCost(nodeIdx) };
+			if (cost < lowestCost)
+				lowestCost = cost;
+		}
+
+		const float bound{ (lowestCost == FLT_MAX || pathCost <= lowestCost) ? 1.f : (lowestCost > 0.f) ? pathCost / lowestCost : m_Epsilon };
+		m_SuboptimalityBound = (bound < m_Epsilon) ? bound : m_Epsilon;
+		if (m_SuboptimalityBound <= 1.f)
+		{
+			m_SuboptimalityBound = 1.f;
+			m_Status = m_IsDestinationReachable ? SearchStatus::Found : SearchStatus::Failed;
+			return true;
+		}
+
+		//The next search starts with nothing closed, the nodes go back on the open list with the keys of the lower epsilon
+		m_Epsilon = (m_Epsilon - m_EpsilonStep > 1.f) ? m_Epsilon - m_EpsilonStep : 1.f;
+		++m_Iteration;
+		for (int nodeIdx : m_IterationNodes)
+			m_OpenList.Push(nodeIdx, OpenRecord{ nodeIdx, m_Records.Get(nodeIdx).costSoFar + m_Epsilon * GetHeuristicCost(nodeIdx) });
+
+		return false;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	inline float ARAStar<T_NodeType, T_ConnectionType, T_OpenList>::GetHeuristicCost(int nodeIdx) const
+	{
+		Vector2 toDestination = m_pGraph->GetNodePos(m_DestinationIdx) - m_pGraph->GetNodePos(nodeIdx);
+		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+	}
+}
@@ -0,0 +1,195 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "SearchContext.h"
+
+namespace Elite
+{
+	//Runs many path queries on a fixed pool of worker threads, the paths come out in the order of the queries no matter which thread found them.
+	//Every thread has its own search context and calls the const FindPath of the pathfinder (AStar, BidirectionalAStar, ThetaStar, JumpPointSearch, HPAStar, ...),
+	//so no search state is shared. The threads take small blocks of queries from a shared counter until none are left.
+	//The graph must not change during a batch, and the pathfinder must not write shared state while searching: don't set a line of sight cache,
+	//and update an HPAStar abstraction before the batch. The compressed adjacency of the graph is rebuilt lazily by the first search after an edit,
+	//FindPaths rebuilds it on the calling thread before the workers start, so they never rebuild it at the same time.
+	//The pathfinder has to expose the graph it searches with GetGraph, every pathfinder with a Context does.
+	//The calling thread works on the batch too, a pool of n threads runs n - 1 workers.
+	template <class T_NodeType, class T_Pathfinder>
+	class BatchPathfinder
+	{
+	public:
+		using Query = std::pair<T_NodeType*, T_NodeType*>; // start and destination
+		using Context = typename T_Pathfinder::Context;
+
+		// nrOfThreads counts the calling thread, 0 takes the number of hardware threads
+		explicit BatchPathfinder(const T_Pathfinder* pPathfinder, int nrOfThreads = 0);
+		~BatchPathfinder();
+
+		// paths[i] is the path of queries[i], the buffers already in paths are reused
+		void FindPaths(const std::vector<Query>& queries, std::vector<std::vector<T_NodeType*>>& paths);
+		// same for nrOfQueries queries starting at pQueries, pPaths has room for as many paths
+		void FindPaths(const Query* pQueries, int nrOfQueries, std::vector<T_NodeType*>* pPaths);
+
+		int GetNrOfThreads() const { return int(m_Threads.size()); }
+		// counters of all searches of the last batch together
+		SearchStatistics GetStatistics() const;
+
+	private:
+		struct ThreadData
+		{
+			Context context;
+			SearchStatistics statistics; // of the searches this thread did in the last batch
+			char padding[64]; // the buffers of neighboring threads are written all the time, keep them off each other's cache lines
+		};
+
+		void WorkerLoop(int threadIdx);
+		// takes blocks of queries until the batch is done
+		void ProcessQueries(int threadIdx);
+
+		const T_Pathfinder* m_pPathfinder;
+		std::vector<ThreadData> m_Threads; // index 0 is the calling thread
+		std::vector<std::thread> m_Workers;
+
+		// the batch that is running
+		const Query* m_pQueries = nullptr;
+		std::vector<T_NodeType*>* m_pPaths = nullptr;
+		int m_NrOfQueries = 0;
+		int m_QueriesPerBlock = 1;
+		std::atomic<int> m_NextQuery{ 0 };
+
+		std::mutex m_Mutex;
+		std::condition_variable m_BatchStarted;
+		std::condition_variable m_BatchFinished;
+		unsigned int m_BatchId = 0; // changes for every batch, the workers wait for it
+		int m_NrOfBusyWorkers = 0;
+		bool m_IsShuttingDown = false;
+
+		BatchPathfinder(const BatchPathfinder&) = delete;
+		BatchPathfinder& operator=(const BatchPathfinder&) = delete;
+	};
+
+	template <class T_NodeType, class T_Pathfinder>
+	BatchPathfinder<T_NodeType, T_Pathfinder>::BatchPathfinder(const T_Pathfinder* pPathfinder, int nrOfThreads)
+		: m_pPathfinder(pPathfinder)
+	{
+		if (nrOfThreads <= 0)
+			nrOfThreads = int(std::thread::hardware_concurrency());
+		if (nrOfThreads <= 0)
+			nrOfThreads = 1;
+
+		m_Threads.resize(nrOfThreads);
+		m_Workers.reserve(nrOfThreads - 1);
+		for (int threadIdx{ 1 }; threadIdx < nrOfThreads; ++threadIdx)
+			m_Workers.emplace_back(&BatchPathfinder::WorkerLoop, this, threadIdx);
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	BatchPathfinder<T_NodeType, T_Pathfinder>::~BatchPathfinder()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_IsShuttingDown = true;
+		}
+		m_BatchStarted.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void BatchPathfinder<T_NodeType, T_Pathfinder>::FindPaths(const std::vector<Query>& queries, std::vector<std::vector<T_NodeType*>>& paths)
+	{
+		paths.resize(queries.size());
+		FindPaths(queries.data(), int(queries.size()), paths.data());
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void BatchPathfinder<T_NodeType, T_Pathfinder>::FindPaths(const Query* pQueries, int nrOfQueries, std::vector<T_NodeType*>* pPaths)
+	{
+		for (ThreadData& threadData : m_Threads)
+			threadData.statistics = SearchStatistics{};
+
+		if (nrOfQueries <= 0)
+			return;
+
+		m_pPathfinder->GetGraph()->EnsureCompactConnections();
+
+		//Blocks small enough that every thread gets several of them, the last blocks even out the differences in query costs
+		const int nrOfThreads{ int(m_Threads.size()) };
+		const int queriesPerBlock{ nrOfQueries / (nrOfThreads * 8) };
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_pQueries = pQueries;
+			m_pPaths = pPaths;
+			m_NrOfQueries = nrOfQueries;
+			m_QueriesPerBlock = (queriesPerBlock < 1) ? 1 : (queriesPerBlock > 32) ? 32 : queriesPerBlock;
+			m_NextQuery = 0;
+			m_NrOfBusyWorkers = int(m_Workers.size());
+			++m_BatchId;
+		}
+		m_BatchStarted.notify_all();
+
+		ProcessQueries(0);
+
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_BatchFinished.wait(lock, [this]() { return m_NrOfBusyWorkers == 0; });
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	SearchStatistics BatchPathfinder<T_NodeType, T_Pathfinder>::GetStatistics() const
+	{
+		SearchStatistics statistics{};
+		for (const ThreadData& threadData : m_Threads)
+		{
+			statistics.nrOfExpandedNodes += threadData.statistics.nrOfExpandedNodes;
+			statistics.nrOfLineOfSightChecks += threadData.statistics.nrOfLineOfSightChecks;
+		}
+
+		return statistics;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void BatchPathfinder<T_NodeType, T_Pathfinder>::WorkerLoop(int threadIdx)
+	{
+		unsigned int lastBatchId{ 0 };
+		while (true)
+		{
+			{
+				std::unique_lock<std::mutex> lock{ m_Mutex };
+				m_BatchStarted.wait(lock, [&]() { return m_IsShuttingDown || m_BatchId != lastBatchId; });
+				if (m_IsShuttingDown)
+					return;
+
+				lastBatchId = m_BatchId;
+			}
+
+			ProcessQueries(threadIdx);
+
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			if (--m_NrOfBusyWorkers == 0)
+				m_BatchFinished.notify_one();
+		}
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void BatchPathfinder<T_NodeType, T_Pathfinder>::ProcessQueries(int threadIdx)
+	{
+		ThreadData& threadData{ m_Threads[threadIdx] };
+		while (true)
+		{
+			const int firstQuery{ m_NextQuery.fetch_add(m_QueriesPerBlock) };
+			if (firstQuery >= m_NrOfQueries)
+				return;
+
+			const int endQuery{ (firstQuery + m_QueriesPerBlock < m_NrOfQueries) ? firstQuery + m_QueriesPerBlock : m_NrOfQueries };
+			for (int queryIdx{ firstQuery }; queryIdx < endQuery; ++queryIdx)
+			{
+				const Query& query{ m_pQueries[queryIdx] };
+				m_pPathfinder->FindPath(query.first, query.second, m_pPaths[queryIdx], threadData.context);
+				threadData.statistics.nrOfExpandedNodes += threadData.context.statistics.nrOfExpandedNodes;
+				threadData.statistics.nrOfLineOfSightChecks += threadData.context.statistics.nrOfLineOfSightChecks;
+			}
+		}
+	}
+}
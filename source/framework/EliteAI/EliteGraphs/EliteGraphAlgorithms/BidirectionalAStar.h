@@ -0,0 +1,233 @@
+#pragma once
+#include "EAStar.h"
+
+namespace Elite
+{
+	//Bidirectional A*: a forward search from the start and a backward search from the destination run in turns, each with the
+	//heuristic towards its own goal (front-to-end). Every node labeled by both searches is a candidate meeting point, the cheapest one is kept.
+	//The search stops once the cheapest meeting point costs no more than the smallest f-cost in one of the open lists: with an admissible
+	//heuristic no unexpanded node of that search can lead to a cheaper path anymore, so the path has the same optimal cost as AStar.
+	//Like BS* it doesn't expand nodes the other search already expanded (nipping) and doesn't label nodes whose f-cost reaches the best
+	//meeting cost (trimming), otherwise both frontiers keep growing past each other until the f-costs catch up with the meeting cost.
+	//The search with the smaller open list is expanded next, so neither frontier grows much larger than the other.
+	//The graph has to be undirected, the backward search walks the connections in the opposite direction.
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap>
+	class BidirectionalAStar
+	{
+	public:
+		BidirectionalAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction);
+
+		// same records as AStar, each direction uses the context of an AStar search
+		using NodeRecord = typename AStar<T_NodeType, T_ConnectionType, T_OpenList>::NodeRecord;
+		using DirectionContext = typename AStar<T_NodeType, T_ConnectionType, T_OpenList>::Context;
+
+		struct Context
+		{
+			DirectionContext forward;
+			DirectionContext backward;
+			SearchStatistics statistics; // both directions together, the direction contexts have the counters per direction
+		};
+
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, no allocations happen once path and the internal context have grown large enough
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// searches with an external context, the pathfinder itself isn't modified
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const;
+
+		// counters of the last search that ran on the internal context
+		const SearchStatistics& GetStatistics() const { return m_Context.statistics; }
+		const SearchStatistics& GetForwardStatistics() const { return m_Context.forward.statistics; }
+		const SearchStatistics& GetBackwardStatistics() const { return m_Context.backward.statistics; }
+
+		// the graph that is searched, BatchPathfinder and PathRequestService prepare it before their threads search it
+		const GridGraph<T_NodeType, T_ConnectionType>* GetGraph() const { return m_pGraph; }
+
+	private:
+		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
+		// expands the best node of one direction, pGoal is the node that direction searches for
+		// bestCost and meetingIdx are lowered when a node labeled by the other direction is reached more cheaply
+		void ExpandNode(DirectionContext& context, const DirectionContext& otherContext, T_NodeType* pGoal, float& bestCost, int& meetingIdx) const;
+		// cost of the record of the node in the open or closed list of the context, FLT_MAX if the node isn't labeled
+		static float GetCostSoFar(const DirectionContext& context, int nodeIdx);
+		static const NodeRecord& GetRecord(const DirectionContext& context, int nodeIdx);
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+
+		// reused by every search started without an external context
+		Context m_Context;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::BidirectionalAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+	{
+		assert(!pGraph->IsDirectionalGraph() && "<BidirectionalAStar>: the backward search needs an undirected graph");
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	std::vector<T_NodeType*> BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const
+	{
+		//The component labels tell right away if the destination can't be reached, the search runs to the closest cell it can reach then
+		if (!m_pGraph->AreConnected(pStartNode->GetIndex(), pDestinationNode->GetIndex()))
+			pDestinationNode = m_pGraph->GetNode(m_pGraph->GetClosestConnectedCell(pStartNode->GetIndex(), pDestinationNode->GetIndex()));
+
+		auto& forwardOpenList{ context.forward.openList };
+		auto& backwardOpenList{ context.backward.openList };
+		context.forward.Reset(m_pGraph->GetNrOfNodes());
+		context.backward.Reset(m_pGraph->GetNrOfNodes());
+		context.statistics = SearchStatistics{};
+
+		path.clear();
+		float bestCost{ FLT_MAX };
+		int meetingIdx{ invalid_node_index };
+
+		forwardOpenList.Push(pStartNode->GetIndex(), NodeRecord{ pStartNode->GetIndex(), invalid_node_index, 0.f, GetHeuristicCost(pStartNode, pDestinationNode) });
+		backwardOpenList.Push(pDestinationNode->GetIndex(), NodeRecord{ pDestinationNode->GetIndex(), invalid_node_index, 0.f, GetHeuristicCost(pDestinationNode, pStartNode) });
+		if (pStartNode == pDestinationNode)
+		{
+			bestCost = 0.f;
+			meetingIdx = pStartNode->GetIndex();
+		}
+
+		while (!forwardOpenList.Empty() && !backwardOpenList.Empty())
+		{
+			const float forwardMinCost{ forwardOpenList.Top().estimatedTotalCost };
+			const float backwardMinCost{ backwardOpenList.Top().estimatedTotalCost };
+			if (bestCost <= ((forwardMinCost > backwardMinCost) ? forwardMinCost : backwardMinCost))
+				break;
+
+			if (forwardOpenList.Size() <= backwardOpenList.Size())
+				ExpandNode(context.forward, context.backward, pDestinationNode, bestCost, meetingIdx);
+			else
+				ExpandNode(context.backward, context.forward, pStartNode, bestCost, meetingIdx);
+		}
+
+		if (meetingIdx == invalid_node_index)
+		{
+			//If the path isn't found, it goes to the node of the forward search closest to the destination like AStar does
+			//That has to be the closest of every node the start can reach, so the forward search finishes the part it didn't explore yet
+			while (!forwardOpenList.Empty())
+				ExpandNode(context.forward, context.backward, pDestinationNode, bestCost, meetingIdx);
+
+			context.statistics.nrOfExpandedNodes = context.forward.statistics.nrOfExpandedNodes + context.backward.statistics.nrOfExpandedNodes;
+
+			for (int idx{ context.forward.closestIdx }; idx != pStartNode->GetIndex(); idx = context.forward.closedList.Get(idx).parentIdx)
+				path.push_back(m_pGraph->GetNode(idx));
+			path.push_back(pStartNode);
+			std::reverse(path.begin(), path.end());
+			return;
+		}
+
+		context.statistics.nrOfExpandedNodes = context.forward.statistics.nrOfExpandedNodes + context.backward.statistics.nrOfExpandedNodes;
+
+		//Forward half: walk from the meeting node back to the start, its parents were all expanded by the forward search
+		const NodeRecord* pRecord{ &GetRecord(context.forward, meetingIdx) };
+		while (pRecord->parentIdx != invalid_node_index)
+		{
+			path.push_back(m_pGraph->GetNode(pRecord->nodeIdx));
+			pRecord = &context.forward.closedList.Get(pRecord->parentIdx);
+		}
+		path.push_back(pStartNode);
+		std::reverse(path.begin(), path.end());
+
+		//Backward half: the parents lead from the meeting node to the destination
+		pRecord = &GetRecord(context.backward, meetingIdx);
+		while (pRecord->parentIdx != invalid_node_index)
+		{
+			path.push_back(m_pGraph->GetNode(pRecord->parentIdx));
+			pRecord = &context.backward.closedList.Get(pRecord->parentIdx);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::ExpandNode(DirectionContext& context, const DirectionContext& otherContext, T_NodeType* pGoal, float& bestCost, int& meetingIdx) const
+	{
+		auto& openList{ context.openList };
+		auto& closedList{ context.closedList };
+
+		NodeRecord currentNodeRecord{ openList.Pop() };
+		closedList.Add(currentNodeRecord.nodeIdx, currentNodeRecord);
+		context.UpdateClosestNode(currentNodeRecord.nodeIdx, currentNodeRecord.estimatedTotalCost - currentNodeRecord.costSoFar);
+
+		//Nipping: the other search already expanded the node, so the path through it was considered when they met
+		if (otherContext.closedList.Contains(currentNodeRecord.nodeIdx))
+			return;
+
+		++context.statistics.nrOfExpandedNodes;
+
+		m_pGraph->ForEachNeighbor(currentNodeRecord.nodeIdx, [&](int nextIdx, float connectionCost)
+		{
+			if (closedList.Contains(nextIdx))
+				return;
+
+			T_NodeType* nextNode{ m_pGraph->GetNode(nextIdx) };
+			float costSoFar{ currentNodeRecord.costSoFar + connectionCost };
+			float estimatedTotalCost{ costSoFar + GetHeuristicCost(nextNode, pGoal) };
+
+			//Trimming: no path through the node can be cheaper than the best one found so far (the other search's cost is at least the heuristic)
+			if (estimatedTotalCost >= bestCost)
+				return;
+
+			if (!openList.Contains(nextIdx))
+			{
+				openList.Push(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, estimatedTotalCost });
+			}
+			else if (openList.Get(nextIdx).costSoFar > costSoFar)
+			{
+				openList.DecreaseKey(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, estimatedTotalCost });
+			}
+			else
+				return;
+
+			//Both searches labeled the node, the path through it is a candidate
+			float otherCostSoFar{ GetCostSoFar(otherContext, nextIdx) };
+			if (otherCostSoFar != FLT_MAX && costSoFar + otherCostSoFar < bestCost)
+			{
+				bestCost = costSoFar + otherCostSoFar;
+				meetingIdx = nextIdx;
+			}
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	float BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::GetCostSoFar(const DirectionContext& context, int nodeIdx)
+	{
+		if (context.closedList.Contains(nodeIdx))
+			return context.closedList.Get(nodeIdx).costSoFar;
+
+		if (context.openList.Contains(nodeIdx))
+			return context.openList.Get(nodeIdx).costSoFar;
+
+		return FLT_MAX;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	const typename BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::NodeRecord& BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::GetRecord(const DirectionContext& context, int nodeIdx)
+	{
+		return context.closedList.Contains(nodeIdx) ? context.closedList.Get(nodeIdx) : context.openList.Get(nodeIdx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	float BidirectionalAStar<T_NodeType, T_ConnectionType, T_OpenList>::GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const
+	{
+		Vector2 toDestination = m_pGraph->GetNodePos(pEndNode) - m_pGraph->GetNodePos(pStartNode);
+		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+	}
+}
@@ -0,0 +1,319 @@
+#pragma once
+#include "EAStar.h"
+
+namespace Elite
+{
+	//D* Lite: incremental search that keeps its results between queries to the same destination.
+	//The search runs backwards from the destination. Every node has a cost to the destination (g) and a one step lookahead of it (rhs: the cheapest
+	//connection cost plus g of a neighbor). Nodes whose g and rhs differ are inconsistent and wait on the open list.
+	//When cells of the graph change only the cells around them get a new rhs, the search then repairs the g values that depend on them
+	//instead of starting over. The start may move between queries, the keys on the open list are corrected with km instead of recomputed.
+	//The changes are read from the journal of the graph. If it doesn't go back to the previous query, or the destination changed, the search starts over.
+	//The graph has to be undirected, the backward search follows the connections in the opposite direction.
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap>
+	class DStarLite
+	{
+	public:
+		DStarLite(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction);
+
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, only a query to a new destination allocates
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+
+		// forgets the search, the next query starts over
+		void Reset() { m_DestinationIdx = invalid_node_index; }
+
+		// counters of the last query: the nodes expanded to plan or to repair the search
+		const SearchStatistics& GetStatistics() const { return m_Statistics; }
+
+	private:
+		// two part key compared lexicographically, nodeIdx is the handle of the record
+		struct OpenRecord
+		{
+			int nodeIdx = invalid_node_index;
+			float primaryKey = 0.f; // min(g, rhs) + h(start, node) + km
+			float secondaryKey = 0.f; // min(g, rhs)
+
+			bool operator<(const OpenRecord& other) const
+			{
+				return primaryKey < other.primaryKey || (primaryKey == other.primaryKey && secondaryKey < other.secondaryKey);
+			};
+		};
+
+		void Initialize(int startIdx, int destinationIdx);
+		// gives the cells around the cells changed since the last query a new rhs, returns false if the journal doesn't go back that far
+		bool ApplyChanges();
+		void ComputeShortestPath();
+		// puts the node on the open list if it is inconsistent, takes it off if it isn't
+		void UpdateVertex(int nodeIdx);
+		float ComputeLookaheadCost(int nodeIdx) const;
+		OpenRecord CalculateKey(int nodeIdx) const;
+		float GetHeuristicCost(int fromIdx, int toIdx) const;
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+
+		// search state kept between queries
+		T_OpenList<OpenRecord> m_OpenList;
+		std::vector<float> m_CostsToDestination; // g
+		std::vector<float> m_LookaheadCosts; // rhs
+		int m_StartIdx = invalid_node_index;
+		int m_DestinationIdx = invalid_node_index;
+		float m_KeyModifier = 0.f; // km, sum of the heuristic distances the start moved
+		unsigned int m_Version = 0;
+		std::vector<int> m_ChangedCells; // reused by ApplyChanges
+
+		// looks for the closest node when the destination can't be reached, like the other searches do
+		AStar<T_NodeType, T_ConnectionType, T_OpenList> m_FallbackSearch;
+		SearchStatistics m_Statistics;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::DStarLite(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+		, m_FallbackSearch(pGraph, hFunction)
+	{
+		assert(!pGraph->IsDirectionalGraph() && "<DStarLite>: the backward search needs an undirected graph");
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	std::vector<T_NodeType*> DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		path.clear();
+		m_Statistics = SearchStatistics{};
+
+		const int startIdx{ pStartNode->GetIndex() };
+		const int destinationIdx{ pDestinationNode->GetIndex() };
+
+		//The component labels tell right away if the destination can't be reached, the repairs wait until it can be reached again
+		if (startIdx != destinationIdx && !m_pGraph->AreConnected(startIdx, destinationIdx))
+		{
+			m_FallbackSearch.FindPath(pStartNode, pDestinationNode, path);
+			m_Statistics.nrOfExpandedNodes += m_FallbackSearch.GetStatistics().nrOfExpandedNodes;
+			return;
+		}
+
+		if (destinationIdx != m_DestinationIdx || int(m_CostsToDestination.size()) != m_pGraph->GetNrOfNodes())
+			Initialize(startIdx, destinationIdx);
+		else
+		{
+			//The keys on the open list were calculated for the previous start, km makes up for the distance it moved
+			if (startIdx != m_StartIdx)
+			{
+				m_KeyModifier += GetHeuristicCost(m_StartIdx, startIdx);
+				m_StartIdx = startIdx;
+			}
+
+			if (!ApplyChanges())
+				Initialize(startIdx, destinationIdx);
+		}
+
+		ComputeShortestPath();
+
+		//The search can stop with the start overconsistent, its rhs is the cost of the path then
+		if (m_LookaheadCosts[startIdx] == FLT_MAX)
+		{
+			m_FallbackSearch.FindPath(pStartNode, pDestinationNode, path);
+			m_Statistics.nrOfExpandedNodes += m_FallbackSearch.GetStatistics().nrOfExpandedNodes;
+			return;
+		}
+
+		//Follow the cheapest connection plus cost to the destination, every step lowers the cost to the destination
+		const int nrOfNodes{ m_pGraph->GetNrOfNodes() };
+		int currentIdx{ startIdx };
+		path.push_back(pStartNode);
+		while (currentIdx != destinationIdx && int(path.size()) <= nrOfNodes)
+		{
+			int nextIdx{ invalid_node_index };
+			float bestCost{ FLT_MAX };
+			m_pGraph->ForEachNeighbor(currentIdx, [&](int neighborIdx, float connectionCost)
+			{
+				if (m_CostsToDestination[neighborIdx] == FLT_MAX)
+					return;
+
+				const float cost{ connectionCost + m_CostsToDestination[neighborIdx] };
+				if (cost < bestCost)
+				{
+					bestCost = cost;
+					nextIdx = neighborIdx;
+				}
+			});
+
+			assert(nextIdx != invalid_node_index && "<DStarLite::FindPath>: the path to the destination is broken");
+			if (nextIdx == invalid_node_index)
+				break;
+
+			currentIdx = nextIdx;
+			path.push_back(m_pGraph->GetNode(currentIdx));
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::Initialize(int startIdx, int destinationIdx)
+	{
+		const int nrOfNodes{ m_pGraph->GetNrOfNodes() };
+		m_OpenList.Clear();
+		m_OpenList.Reserve(nrOfNodes);
+		m_CostsToDestination.assign(nrOfNodes, FLT_MAX);
+		m_LookaheadCosts.assign(nrOfNodes, FLT_MAX);
+		m_StartIdx = startIdx;
+		m_DestinationIdx = destinationIdx;
+		m_KeyModifier = 0.f;
+		m_Version = m_pGraph->GetVersion();
+
+		m_LookaheadCosts[destinationIdx] = 0.f;
+		m_OpenList.Push(destinationIdx, CalculateKey(destinationIdx));
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	bool DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::ApplyChanges()
+	{
+		if (m_Version == m_pGraph->GetVersion())
+			return true;
+
+		m_ChangedCells.clear();
+		if (!m_pGraph->GetChangedCells(m_Version, m_ChangedCells))
+			return false;
+		m_Version = m_pGraph->GetVersion();
+
+		//A changed cell changes the costs of its own connections and (through corner cutting) of the diagonals between its neighbors,
+		//all of them connect cells of the 3x3 block around it
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		const int nrOfRows{ m_pGraph->GetRows() };
+		for (int changedIdx : m_ChangedCells)
+		{
+			const int col{ changedIdx % nrOfColumns };
+			const int row{ changedIdx / nrOfColumns };
+			for (int neighborRow{ row - 1 }; neighborRow <= row + 1; ++neighborRow)
+			{
+				for (int neighborCol{ col - 1 }; neighborCol <= col + 1; ++neighborCol)
+				{
+					if (neighborCol < 0 || neighborCol >= nrOfColumns || neighborRow < 0 || neighborRow >= nrOfRows)
+						continue;
+
+					const int nodeIdx{ neighborRow * nrOfColumns + neighborCol };
+					if (nodeIdx == m_DestinationIdx)
+						continue;
+
+					m_LookaheadCosts[nodeIdx] = ComputeLookaheadCost(nodeIdx);
+					UpdateVertex(nodeIdx);
+				}
+			}
+		}
+
+		return true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::ComputeShortestPath()
+	{
+		while (!m_OpenList.Empty()
+			&& (m_OpenList.Top() < CalculateKey(m_StartIdx) || m_LookaheadCosts[m_StartIdx] > m_CostsToDestination[m_StartIdx]))
+		{
+			const OpenRecord oldKey{ m_OpenList.Top() };
+			const int nodeIdx{ oldKey.nodeIdx };
+
+			//The key is outdated when the start moved since it was calculated
+			const OpenRecord newKey{ CalculateKey(nodeIdx) };
+			if (oldKey < newKey)
+			{
+				m_OpenList.Update(nodeIdx, newKey);
+				continue;
+			}
+
+			++m_Statistics.nrOfExpandedNodes;
+			float& costToDestination{ m_CostsToDestination[nodeIdx] };
+			if (costToDestination > m_LookaheadCosts[nodeIdx])
+			{
+				//Overconsistent: the node got cheaper, the neighbors may get cheaper through it
+				costToDestination = m_LookaheadCosts[nodeIdx];
+				m_OpenList.Pop();
+				m_pGraph->ForEachNeighbor(nodeIdx, [&](int neighborIdx, float connectionCost)
+				{
+					const float costThroughNode{ connectionCost + costToDestination };
+					if (neighborIdx != m_DestinationIdx && costThroughNode < m_LookaheadCosts[neighborIdx])
+					{
+						m_LookaheadCosts[neighborIdx] = costThroughNode;
+						UpdateVertex(neighborIdx);
+					}
+				});
+			}
+			else
+			{
+				//Underconsistent: the node got more expensive, the neighbors that went through it look for another way
+				const float oldCostToDestination{ costToDestination };
+				costToDestination = FLT_MAX;
+				UpdateVertex(nodeIdx);
+				m_pGraph->ForEachNeighbor(nodeIdx, [&](int neighborIdx, float connectionCost)
+				{
+					if (neighborIdx != m_DestinationIdx && m_LookaheadCosts[neighborIdx] == connectionCost + oldCostToDestination)
+					{
+						m_LookaheadCosts[neighborIdx] = ComputeLookaheadCost(neighborIdx);
+						UpdateVertex(neighborIdx);
+					}
+				});
+			}
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::UpdateVertex(int nodeIdx)
+	{
+		const bool isInconsistent{ m_CostsToDestination[nodeIdx] != m_LookaheadCosts[nodeIdx] };
+		if (m_OpenList.Contains(nodeIdx))
+		{
+			if (isInconsistent)
+				m_OpenList.Update(nodeIdx, CalculateKey(nodeIdx));
+			else
+				m_OpenList.Remove(nodeIdx);
+		}
+		else if (isInconsistent)
+			m_OpenList.Push(nodeIdx, CalculateKey(nodeIdx));
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	float DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::ComputeLookaheadCost(int nodeIdx) const
+	{
+		float lookaheadCost{ FLT_MAX };
+		m_pGraph->ForEachNeighbor(nodeIdx, [&](int neighborIdx, float connectionCost)
+		{
+			if (m_CostsToDestination[neighborIdx] == FLT_MAX)
+				return;
+
+			const float cost{ connectionCost + m_CostsToDestination[neighborIdx] };
+			if (cost < lookaheadCost)
+				lookaheadCost = cost;
+		});
+
+		return lookaheadCost;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	typename DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::OpenRecord DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::CalculateKey(int nodeIdx) const
+	{
+		const float g{ m_CostsToDestination[nodeIdx] };
+		const float rhs{ m_LookaheadCosts[nodeIdx] };
+		const float cost{ (g < rhs) ? g : rhs };
+		if (cost == FLT_MAX)
+			return OpenRecord{ nodeIdx, FLT_MAX, FLT_MAX };
+
+		return OpenRecord{ nodeIdx, cost + GetHeuristicCost(m_StartIdx, nodeIdx) + m_KeyModifier, cost };
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	float DStarLite<T_NodeType, T_ConnectionType, T_OpenList>::GetHeuristicCost(int fromIdx, int toIdx) const
+	{
+		Vector2 toDestination = m_pGraph->GetNodePos(toIdx) - m_pGraph->GetNodePos(fromIdx);
+		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+	}
+}
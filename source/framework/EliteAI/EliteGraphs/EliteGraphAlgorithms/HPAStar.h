@@ -0,0 +1,692 @@
+#pragma once
+#include "EAStar.h"
+
+namespace Elite
+{
+	//Hierarchical pathfinding A* (HPA*): the grid is split in square clusters and searched on two levels.
+	//Where two neighboring clusters touch, every run of connected cell pairs along their border is an entrance. Short entrances get one
+	//transition in the middle, long ones one at each end. A diagonal step that crosses a border (or a cluster corner) where no straight step
+	//can is a transition of its own, so every path of the grid still exists on the abstract level.
+	//The cells of the transitions are the abstract nodes. Transitions connect them across the borders, and the distances between the abstract
+	//nodes of a cluster (staying inside the cluster) are cached as its intra cluster edges.
+	//A query links the start and destination to the abstract nodes of their clusters, searches the small abstract graph and then refines the
+	//abstract path segment by segment with T_Refiner (AStar, ThetaStar, ...), all at once or only the segments that are needed next.
+	//The abstraction follows the edits of the graph through its change journal: a changed cell rebuilds its own cluster and the borders it lies on,
+	//a neighboring cluster is only rebuilt when the transitions of the border they share changed.
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner = AStar, template<class> class T_OpenList = BinaryHeap>
+	class HPAStar
+	{
+	public:
+		HPAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, int clusterSize = 10);
+
+		using Refiner = T_Refiner<T_NodeType, T_ConnectionType, T_OpenList, RuntimeHeuristic>; // made with the heuristic of the HPAStar
+		using NodeRecord = typename AStar<T_NodeType, T_ConnectionType, T_OpenList>::NodeRecord;
+
+		// search that stays inside one cluster, the distances are indexed by the position of the cell in the cluster
+		struct ClusterRecord
+		{
+			int localIdx = 0;
+			float costSoFar = 0.f;
+
+			bool operator<(const ClusterRecord& other) const { return costSoFar < other.costSoFar; }
+		};
+
+		struct ClusterSearch
+		{
+			BinaryHeap<ClusterRecord> openList;
+			std::vector<float> distances;
+		};
+
+		struct Context
+		{
+			SearchContext<NodeRecord, T_OpenList> abstractContext;
+			typename Refiner::Context refinerContext;
+			ClusterSearch startSearch;
+			ClusterSearch destinationSearch;
+			std::vector<T_NodeType*> abstractPath;
+			std::vector<T_NodeType*> segment;
+			SearchStatistics statistics; // the abstract search and the refinement together
+		};
+
+		// update the abstraction first, then search and refine the whole path
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, no allocations happen once path and the internal context have grown large enough
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// searches with an external context, the pathfinder itself isn't modified so the abstraction has to be up to date
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const;
+
+		// writes the start, the abstract nodes on the way and the destination in abstractPath, returns false if the destination can't be reached
+		bool FindAbstractPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& abstractPath, Context& context) const;
+		// writes the refined path of the first nrOfSegments segments of the abstract path in path (a negative number refines all of them)
+		void RefinePath(const std::vector<T_NodeType*>& abstractPath, std::vector<T_NodeType*>& path, Context& context, int nrOfSegments = -1) const;
+
+		// applies the changes made to the graph since the last update
+		void UpdateAbstraction();
+		bool IsUpToDate() const { return m_Version == m_pGraph->GetVersion(); }
+
+		int GetClusterSize() const { return m_ClusterSize; }
+		int GetNrOfClusters() const { return int(m_Clusters.size()); }
+		int GetNrOfAbstractNodes() const;
+		// clusters rebuilt by the last update that found changes
+		int GetNrOfRebuiltClusters() const { return m_NrOfRebuiltClusters; }
+
+		// counters of the last search that ran on the internal context
+		const SearchStatistics& GetStatistics() const { return m_Context.statistics; }
+
+		// the graph that is searched, BatchPathfinder and PathRequestService prepare it before their threads search it
+		const GridGraph<T_NodeType, T_ConnectionType>* GetGraph() const { return m_pGraph; }
+
+	private:
+		struct Transition
+		{
+			int cellIdx = invalid_node_index;
+			int otherCellIdx = invalid_node_index;
+			float cost = 0.f;
+
+			bool operator==(const Transition& other) const
+			{
+				return cellIdx == other.cellIdx
+					&& otherCellIdx == other.otherCellIdx
+					&& cost == other.cost;
+			};
+		};
+
+		struct Cluster
+		{
+			std::vector<int> cells; // the abstract nodes inside the cluster, sorted
+			std::vector<Transition> transitions; // transitions to the other clusters, cellIdx is the cell inside this cluster
+			std::vector<float> distances; // distances[i * cells.size() + j]: cheapest path from cells[i] to cells[j] inside the cluster, FLT_MAX if there's none
+		};
+
+		enum { MinDoubleTransitionLength = 6 }; // entrances at least this long get a transition at both ends
+
+		int GetClusterIndex(int cellIdx) const;
+		void GetClusterBounds(int clusterIdx, int& firstCol, int& firstRow, int& lastCol, int& lastRow) const;
+		int GetLocalIndex(int clusterIdx, int cellIdx) const;
+
+		// (re)builds everything
+		void Build();
+		// the border east (or south) of the cluster, a border is stored with the cluster west (or north) of it
+		void BuildBorder(int clusterIdx, bool isEastBorder, std::vector<Transition>& transitions) const;
+		// the diagonal crossings at the south east corner of the cluster, a corner is stored with the cluster north west of it
+		void BuildCorner(int clusterIdx, std::vector<Transition>& transitions) const;
+		void BuildCluster(int clusterIdx);
+		// marks the cluster and (if the transitions differ) the clusters the transitions connect as dirty before replacing the transitions
+		void ReplaceTransitions(std::vector<Transition>& transitions, const std::vector<Transition>& newTransitions);
+		void MarkClusterDirty(int clusterIdx);
+
+		void AddTransition(int fromIdx, int toIdx, std::vector<Transition>& transitions) const;
+		bool AreConnected(int fromIdx, int toIdx) const;
+		// distances from the cell to every cell of its cluster, without leaving the cluster
+		void SearchCluster(int cellIdx, ClusterSearch& search) const;
+		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+		Refiner m_Refiner;
+
+		int m_ClusterSize;
+		int m_NrOfClusterColumns;
+		int m_NrOfClusterRows;
+		std::vector<Cluster> m_Clusters;
+		std::vector<std::vector<Transition>> m_EastBorders;
+		std::vector<std::vector<Transition>> m_SouthBorders;
+		std::vector<std::vector<Transition>> m_Corners;
+
+		unsigned int m_Version;
+		int m_NrOfRebuiltClusters = 0;
+
+		// scratch buffers of the updates
+		std::vector<int> m_ChangedCells;
+		std::vector<int> m_DirtyClusters;
+		std::vector<bool> m_IsClusterDirty;
+		std::vector<Transition> m_NewTransitions;
+		ClusterSearch m_ClusterSearch;
+
+		// reused by every search started without an external context
+		Context m_Context;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::HPAStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, int clusterSize)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+		, m_Refiner(pGraph, hFunction)
+		, m_ClusterSize(clusterSize)
+		, m_NrOfClusterColumns((pGraph->GetColumns() + clusterSize - 1) / clusterSize)
+		, m_NrOfClusterRows((pGraph->GetRows() + clusterSize - 1) / clusterSize)
+		, m_Version(pGraph->GetVersion())
+	{
+		assert(clusterSize > 0 && "<HPAStar>: cluster size has to be positive");
+		assert(!pGraph->IsDirectionalGraph() && "<HPAStar>: the cluster distances are only valid in both directions for an undirected graph");
+
+		Build();
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	std::vector<T_NodeType*> HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		UpdateAbstraction();
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const
+	{
+		//The component labels tell right away if the destination can't be reached, the abstract search is skipped then
+		context.statistics = SearchStatistics{};
+		if (m_pGraph->AreConnected(pStartNode->GetIndex(), pDestinationNode->GetIndex())
+			&& FindAbstractPath(pStartNode, pDestinationNode, context.abstractPath, context))
+		{
+			RefinePath(context.abstractPath, path, context);
+			return;
+		}
+
+		//Every path of the grid exists on the abstract level, so the destination can't be reached
+		//The refiner looks for the closest node like the flat searches do
+		m_Refiner.FindPath(pStartNode, pDestinationNode, path, context.refinerContext);
+		context.statistics.nrOfExpandedNodes += context.refinerContext.statistics.nrOfExpandedNodes;
+		context.statistics.nrOfLineOfSightChecks += context.refinerContext.statistics.nrOfLineOfSightChecks;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	bool HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::FindAbstractPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& abstractPath, Context& context) const
+	{
+		assert(IsUpToDate() && "<HPAStar::FindAbstractPath>: the graph changed, call UpdateAbstraction first");
+
+		auto& openList{ context.abstractContext.openList };
+		auto& closedList{ context.abstractContext.closedList };
+		context.abstractContext.Reset(m_pGraph->GetNrOfNodes());
+		context.statistics = SearchStatistics{};
+		abstractPath.clear();
+
+		//Link the start and destination to the abstract nodes of their clusters
+		const int startIdx{ pStartNode->GetIndex() };
+		const int destinationIdx{ pDestinationNode->GetIndex() };
+		const int destinationClusterIdx{ GetClusterIndex(destinationIdx) };
+		SearchCluster(startIdx, context.startSearch);
+		SearchCluster(destinationIdx, context.destinationSearch);
+
+		NodeRecord currentNodeRecord;
+		bool pathFound = false;
+
+		openList.Push(startIdx, NodeRecord{ startIdx, invalid_node_index, 0.f, GetHeuristicCost(pStartNode, pDestinationNode) });
+		while (!openList.Empty() && !pathFound)
+		{
+			currentNodeRecord = openList.Pop();
+			closedList.Add(currentNodeRecord.nodeIdx, currentNodeRecord);
+			++context.abstractContext.statistics.nrOfExpandedNodes;
+
+			if (currentNodeRecord.nodeIdx == destinationIdx)
+			{
+				pathFound = true;
+				break;
+			}
+
+			auto updateNeighbor = [&](int nextIdx, float connectionCost)
+			{
+				if (connectionCost == FLT_MAX || closedList.Contains(nextIdx))
+					return;
+
+				T_NodeType* nextNode{ m_pGraph->GetNode(nextIdx) };
+				float costSoFar{ currentNodeRecord.costSoFar + connectionCost };
+				if (!openList.Contains(nextIdx))
+				{
+					openList.Push(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, costSoFar + GetHeuristicCost(nextNode, pDestinationNode) });
+				}
+				else if (openList.Get(nextIdx).costSoFar > costSoFar)
+				{
+					openList.DecreaseKey(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, costSoFar + GetHeuristicCost(nextNode, pDestinationNode) });
+				}
+			};
+
+			const int currentIdx{ currentNodeRecord.nodeIdx };
+			const int clusterIdx{ GetClusterIndex(currentIdx) };
+			const Cluster& cluster{ m_Clusters[clusterIdx] };
+
+			if (currentIdx == startIdx)
+			{
+				for (int cellIdx : cluster.cells)
+					updateNeighbor(cellIdx, context.startSearch.distances[GetLocalIndex(clusterIdx, cellIdx)]);
+			}
+
+			if (clusterIdx == destinationClusterIdx)
+			{
+				const ClusterSearch& search{ (currentIdx == startIdx) ? context.startSearch : context.destinationSearch };
+				const int targetIdx{ (currentIdx == startIdx) ? destinationIdx : currentIdx };
+				updateNeighbor(destinationIdx, search.distances[GetLocalIndex(clusterIdx, targetIdx)]);
+			}
+
+			auto cellIt = std::lower_bound(cluster.cells.cbegin(), cluster.cells.cend(), currentIdx);
+			if (cellIt == cluster.cells.cend() || *cellIt != currentIdx)
+				continue;
+
+			const size_t nrOfCells{ cluster.cells.size() };
+			const size_t cellPos{ size_t(cellIt - cluster.cells.cbegin()) };
+			for (size_t otherPos{ 0 }; otherPos < nrOfCells; ++otherPos)
+			{
+				if (otherPos != cellPos)
+					updateNeighbor(cluster.cells[otherPos], cluster.distances[cellPos * nrOfCells + otherPos]);
+			}
+
+			for (const Transition& transition : cluster.transitions)
+			{
+				if (transition.cellIdx == currentIdx)
+					updateNeighbor(transition.otherCellIdx, transition.cost);
+			}
+		}
+
+		context.statistics.nrOfExpandedNodes += context.abstractContext.statistics.nrOfExpandedNodes;
+		if (!pathFound)
+			return false;
+
+		for (int idx{ destinationIdx }; idx != startIdx; idx = closedList.Get(idx).parentIdx)
+			abstractPath.push_back(m_pGraph->GetNode(idx));
+		abstractPath.push_back(pStartNode);
+		std::reverse(abstractPath.begin(), abstractPath.end());
+
+		return true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::RefinePath(const std::vector<T_NodeType*>& abstractPath, std::vector<T_NodeType*>& path, Context& context, int nrOfSegments) const
+	{
+		path.clear();
+		if (abstractPath.empty())
+			return;
+
+		const int nrOfAbstractSegments{ int(abstractPath.size()) - 1 };
+		if (nrOfSegments < 0 || nrOfSegments > nrOfAbstractSegments)
+			nrOfSegments = nrOfAbstractSegments;
+
+		path.push_back(abstractPath[0]);
+		for (int segmentIdx{ 0 }; segmentIdx < nrOfSegments; ++segmentIdx)
+		{
+			m_Refiner.FindPath(abstractPath[segmentIdx], abstractPath[segmentIdx + 1], context.segment, context.refinerContext);
+			context.statistics.nrOfExpandedNodes += context.refinerContext.statistics.nrOfExpandedNodes;
+			context.statistics.nrOfLineOfSightChecks += context.refinerContext.statistics.nrOfLineOfSightChecks;
+
+			//Every segment starts where the previous one ended
+			path.insert(path.end(), context.segment.cbegin() + 1, context.segment.cend());
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::UpdateAbstraction()
+	{
+		if (IsUpToDate())
+			return;
+
+		m_ChangedCells.clear();
+		if (!m_pGraph->GetChangedCells(m_Version, m_ChangedCells))
+		{
+			//The journal doesn't go back far enough to know what changed
+			Build();
+			return;
+		}
+		m_Version = m_pGraph->GetVersion();
+
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		const int nrOfRows{ m_pGraph->GetRows() };
+		m_DirtyClusters.clear();
+		for (int cellIdx : m_ChangedCells)
+		{
+			const int col{ cellIdx % nrOfColumns };
+			const int row{ cellIdx / nrOfColumns };
+			MarkClusterDirty(GetClusterIndex(cellIdx));
+
+			//Borders next to the cell, a border belongs to the cluster west or north of it
+			if (col % m_ClusterSize == m_ClusterSize - 1 && col + 1 < nrOfColumns)
+			{
+				BuildBorder(GetClusterIndex(cellIdx), true, m_NewTransitions);
+				ReplaceTransitions(m_EastBorders[GetClusterIndex(cellIdx)], m_NewTransitions);
+			}
+			if (col % m_ClusterSize == 0 && col > 0)
+			{
+				BuildBorder(GetClusterIndex(cellIdx - 1), true, m_NewTransitions);
+				ReplaceTransitions(m_EastBorders[GetClusterIndex(cellIdx - 1)], m_NewTransitions);
+			}
+			if (row % m_ClusterSize == m_ClusterSize - 1 && row + 1 < nrOfRows)
+			{
+				BuildBorder(GetClusterIndex(cellIdx), false, m_NewTransitions);
+				ReplaceTransitions(m_SouthBorders[GetClusterIndex(cellIdx)], m_NewTransitions);
+			}
+			if (row % m_ClusterSize == 0 && row > 0)
+			{
+				BuildBorder(GetClusterIndex(cellIdx - nrOfColumns), false, m_NewTransitions);
+				ReplaceTransitions(m_SouthBorders[GetClusterIndex(cellIdx - nrOfColumns)], m_NewTransitions);
+			}
+
+			//Cluster corners at the corners of the cell, a corner belongs to the cluster north west of it
+			for (int cornerCol{ col }; cornerCol <= col + 1; ++cornerCol)
+			{
+				for (int cornerRow{ row }; cornerRow <= row + 1; ++cornerRow)
+				{
+					if (cornerCol % m_ClusterSize != 0 || cornerRow % m_ClusterSize != 0
+						|| cornerCol == 0 || cornerRow == 0 || cornerCol >= nrOfColumns || cornerRow >= nrOfRows)
+						continue;
+
+					const int cornerClusterIdx{ GetClusterIndex(m_pGraph->GetIndex(cornerCol - 1, cornerRow - 1)) };
+					BuildCorner(cornerClusterIdx, m_NewTransitions);
+					ReplaceTransitions(m_Corners[cornerClusterIdx], m_NewTransitions);
+				}
+			}
+		}
+
+		for (int clusterIdx : m_DirtyClusters)
+		{
+			BuildCluster(clusterIdx);
+			m_IsClusterDirty[clusterIdx] = false;
+		}
+		m_NrOfRebuiltClusters = int(m_DirtyClusters.size());
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	int HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::GetNrOfAbstractNodes() const
+	{
+		int nrOfAbstractNodes{ 0 };
+		for (const Cluster& cluster : m_Clusters)
+			nrOfAbstractNodes += int(cluster.cells.size());
+
+		return nrOfAbstractNodes;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	inline int HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::GetClusterIndex(int cellIdx) const
+	{
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		return (cellIdx / nrOfColumns / m_ClusterSize) * m_NrOfClusterColumns + (cellIdx % nrOfColumns) / m_ClusterSize;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::GetClusterBounds(int clusterIdx, int& firstCol, int& firstRow, int& lastCol, int& lastRow) const
+	{
+		firstCol = (clusterIdx % m_NrOfClusterColumns) * m_ClusterSize;
+		firstRow = (clusterIdx / m_NrOfClusterColumns) * m_ClusterSize;
+		lastCol = (firstCol + m_ClusterSize < m_pGraph->GetColumns()) ? firstCol + m_ClusterSize - 1 : m_pGraph->GetColumns() - 1;
+		lastRow = (firstRow + m_ClusterSize < m_pGraph->GetRows()) ? firstRow + m_ClusterSize - 1 : m_pGraph->GetRows() - 1;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	inline int HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::GetLocalIndex(int clusterIdx, int cellIdx) const
+	{
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		const int firstCol{ (clusterIdx % m_NrOfClusterColumns) * m_ClusterSize };
+		const int firstRow{ (clusterIdx / m_NrOfClusterColumns) * m_ClusterSize };
+		const int width{ (firstCol + m_ClusterSize < nrOfColumns) ? m_ClusterSize : nrOfColumns - firstCol };
+		return (cellIdx / nrOfColumns - firstRow) * width + (cellIdx % nrOfColumns - firstCol);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::Build()
+	{
+		const int nrOfClusters{ m_NrOfClusterColumns * m_NrOfClusterRows };
+		m_Clusters.assign(nrOfClusters, Cluster{});
+		m_EastBorders.assign(nrOfClusters, std::vector<Transition>{});
+		m_SouthBorders.assign(nrOfClusters, std::vector<Transition>{});
+		m_Corners.assign(nrOfClusters, std::vector<Transition>{});
+		m_IsClusterDirty.assign(nrOfClusters, false);
+
+		for (int clusterIdx{ 0 }; clusterIdx < nrOfClusters; ++clusterIdx)
+		{
+			BuildBorder(clusterIdx, true, m_EastBorders[clusterIdx]);
+			BuildBorder(clusterIdx, false, m_SouthBorders[clusterIdx]);
+			BuildCorner(clusterIdx, m_Corners[clusterIdx]);
+		}
+
+		for (int clusterIdx{ 0 }; clusterIdx < nrOfClusters; ++clusterIdx)
+			BuildCluster(clusterIdx);
+
+		m_Version = m_pGraph->GetVersion();
+		m_NrOfRebuiltClusters = nrOfClusters;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::BuildBorder(int clusterIdx, bool isEastBorder, std::vector<Transition>& transitions) const
+	{
+		transitions.clear();
+
+		int firstCol, firstRow, lastCol, lastRow;
+		GetClusterBounds(clusterIdx, firstCol, firstRow, lastCol, lastRow);
+		if (isEastBorder ? lastCol + 1 >= m_pGraph->GetColumns() : lastRow + 1 >= m_pGraph->GetRows())
+			return;
+
+		//Walk along the border, side 0 is the cell in this cluster and side 1 the cell next to it in the neighboring cluster
+		const int first{ isEastBorder ? firstRow : firstCol };
+		const int last{ isEastBorder ? lastRow : lastCol };
+		auto getCell = [&](int pos, int side)
+		{
+			return isEastBorder ? m_pGraph->GetIndex(lastCol + side, pos) : m_pGraph->GetIndex(pos, lastRow + side);
+		};
+		auto isCrossing = [&](int pos) { return AreConnected(getCell(pos, 0), getCell(pos, 1)); };
+
+		int entranceStart{ -1 };
+		for (int pos{ first }; pos <= last + 1; ++pos)
+		{
+			const bool isOpen{ pos <= last && isCrossing(pos) };
+			if (isOpen && entranceStart < 0)
+			{
+				entranceStart = pos;
+			}
+			else if (!isOpen && entranceStart >= 0)
+			{
+				const int entranceEnd{ pos - 1 };
+				if (entranceEnd - entranceStart + 1 < MinDoubleTransitionLength)
+				{
+					const int middle{ (entranceStart + entranceEnd) / 2 };
+					AddTransition(getCell(middle, 0), getCell(middle, 1), transitions);
+				}
+				else
+				{
+					AddTransition(getCell(entranceStart, 0), getCell(entranceStart, 1), transitions);
+					AddTransition(getCell(entranceEnd, 0), getCell(entranceEnd, 1), transitions);
+				}
+				entranceStart = -1;
+			}
+		}
+
+		//A diagonal step can cross the border where neither straight step next to it can
+		if (!m_pGraph->IsConnectedDiagonally())
+			return;
+
+		for (int pos{ first }; pos < last; ++pos)
+		{
+			if (isCrossing(pos) || isCrossing(pos + 1))
+				continue;
+
+			if (AreConnected(getCell(pos, 0), getCell(pos + 1, 1)))
+				AddTransition(getCell(pos, 0), getCell(pos + 1, 1), transitions);
+			if (AreConnected(getCell(pos + 1, 0), getCell(pos, 1)))
+				AddTransition(getCell(pos + 1, 0), getCell(pos, 1), transitions);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::BuildCorner(int clusterIdx, std::vector<Transition>& transitions) const
+	{
+		transitions.clear();
+
+		int firstCol, firstRow, lastCol, lastRow;
+		GetClusterBounds(clusterIdx, firstCol, firstRow, lastCol, lastRow);
+		if (!m_pGraph->IsConnectedDiagonally() || lastCol + 1 >= m_pGraph->GetColumns() || lastRow + 1 >= m_pGraph->GetRows())
+			return;
+
+		//The four cells around the corner, each in another cluster
+		const int northWest{ m_pGraph->GetIndex(lastCol, lastRow) };
+		const int northEast{ m_pGraph->GetIndex(lastCol + 1, lastRow) };
+		const int southWest{ m_pGraph->GetIndex(lastCol, lastRow + 1) };
+		const int southEast{ m_pGraph->GetIndex(lastCol + 1, lastRow + 1) };
+
+		//A diagonal only needs a transition when the two straight detours around the corner are blocked
+		if (AreConnected(northWest, southEast)
+			&& !(AreConnected(northWest, northEast) && AreConnected(northEast, southEast))
+			&& !(AreConnected(northWest, southWest) && AreConnected(southWest, southEast)))
+			AddTransition(northWest, southEast, transitions);
+
+		if (AreConnected(northEast, southWest)
+			&& !(AreConnected(northEast, northWest) && AreConnected(northWest, southWest))
+			&& !(AreConnected(northEast, southEast) && AreConnected(southEast, southWest)))
+			AddTransition(northEast, southWest, transitions);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::BuildCluster(int clusterIdx)
+	{
+		Cluster& cluster{ m_Clusters[clusterIdx] };
+		cluster.transitions.clear();
+		cluster.cells.clear();
+
+		//Gather the transitions of the borders and corners around the cluster, seen from this cluster
+		const int clusterCol{ clusterIdx % m_NrOfClusterColumns };
+		const int clusterRow{ clusterIdx / m_NrOfClusterColumns };
+		auto addTransitions = [&](const std::vector<Transition>& transitions)
+		{
+			for (const Transition& transition : transitions)
+			{
+				if (GetClusterIndex(transition.cellIdx) == clusterIdx)
+					cluster.transitions.push_back(transition);
+				else if (GetClusterIndex(transition.otherCellIdx) == clusterIdx)
+					cluster.transitions.push_back(Transition{ transition.otherCellIdx, transition.cellIdx, transition.cost });
+			}
+		};
+
+		addTransitions(m_EastBorders[clusterIdx]);
+		addTransitions(m_SouthBorders[clusterIdx]);
+		addTransitions(m_Corners[clusterIdx]);
+		if (clusterCol > 0)
+		{
+			addTransitions(m_EastBorders[clusterIdx - 1]);
+			addTransitions(m_Corners[clusterIdx - 1]);
+		}
+		if (clusterRow > 0)
+		{
+			addTransitions(m_SouthBorders[clusterIdx - m_NrOfClusterColumns]);
+			addTransitions(m_Corners[clusterIdx - m_NrOfClusterColumns]);
+		}
+		if (clusterCol > 0 && clusterRow > 0)
+			addTransitions(m_Corners[clusterIdx - m_NrOfClusterColumns - 1]);
+
+		for (const Transition& transition : cluster.transitions)
+			cluster.cells.push_back(transition.cellIdx);
+		std::sort(cluster.cells.begin(), cluster.cells.end());
+		cluster.cells.erase(std::unique(cluster.cells.begin(), cluster.cells.end()), cluster.cells.end());
+
+		//Cache the distances between all abstract nodes of the cluster
+		const size_t nrOfCells{ cluster.cells.size() };
+		cluster.distances.resize(nrOfCells * nrOfCells);
+		for (size_t fromPos{ 0 }; fromPos < nrOfCells; ++fromPos)
+		{
+			SearchCluster(cluster.cells[fromPos], m_ClusterSearch);
+			for (size_t toPos{ 0 }; toPos < nrOfCells; ++toPos)
+				cluster.distances[fromPos * nrOfCells + toPos] = m_ClusterSearch.distances[GetLocalIndex(clusterIdx, cluster.cells[toPos])];
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::ReplaceTransitions(std::vector<Transition>& transitions, const std::vector<Transition>& newTransitions)
+	{
+		if (transitions == newTransitions)
+			return;
+
+		for (const Transition& transition : transitions)
+		{
+			MarkClusterDirty(GetClusterIndex(transition.cellIdx));
+			MarkClusterDirty(GetClusterIndex(transition.otherCellIdx));
+		}
+		for (const Transition& transition : newTransitions)
+		{
+			MarkClusterDirty(GetClusterIndex(transition.cellIdx));
+			MarkClusterDirty(GetClusterIndex(transition.otherCellIdx));
+		}
+
+		transitions = newTransitions;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	inline void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::MarkClusterDirty(int clusterIdx)
+	{
+		if (m_IsClusterDirty[clusterIdx])
+			return;
+
+		m_IsClusterDirty[clusterIdx] = true;
+		m_DirtyClusters.push_back(clusterIdx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::AddTransition(int fromIdx, int toIdx, std::vector<Transition>& transitions) const
+	{
+		float cost{ FLT_MAX };
+		m_pGraph->ForEachNeighbor(fromIdx, [&](int neighborIdx, float connectionCost)
+		{
+			if (neighborIdx == toIdx)
+				cost = connectionCost;
+		});
+
+		transitions.push_back(Transition{ fromIdx, toIdx, cost });
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	inline bool HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::AreConnected(int fromIdx, int toIdx) const
+	{
+		return m_pGraph->AreAdjacentCellsConnected(fromIdx, toIdx);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	void HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::SearchCluster(int cellIdx, ClusterSearch& search) const
+	{
+		//Dijkstra from the cell, neighbors outside the cluster are skipped
+		const int clusterIdx{ GetClusterIndex(cellIdx) };
+		int firstCol, firstRow, lastCol, lastRow;
+		GetClusterBounds(clusterIdx, firstCol, firstRow, lastCol, lastRow);
+		const int width{ lastCol - firstCol + 1 };
+		const int nrOfCells{ width * (lastRow - firstRow + 1) };
+
+		auto& openList{ search.openList };
+		search.distances.assign(nrOfCells, FLT_MAX);
+		openList.Clear();
+		openList.Reserve(nrOfCells);
+
+		const int startLocalIdx{ GetLocalIndex(clusterIdx, cellIdx) };
+		search.distances[startLocalIdx] = 0.f;
+		openList.Push(startLocalIdx, ClusterRecord{ startLocalIdx, 0.f });
+		while (!openList.Empty())
+		{
+			const ClusterRecord currentRecord{ openList.Pop() };
+			const int currentIdx{ m_pGraph->GetIndex(firstCol + currentRecord.localIdx % width, firstRow + currentRecord.localIdx / width) };
+			m_pGraph->ForEachNeighbor(currentIdx, [&](int nextIdx, float connectionCost)
+			{
+				const int nextCol{ nextIdx % m_pGraph->GetColumns() };
+				const int nextRow{ nextIdx / m_pGraph->GetColumns() };
+				if (nextCol < firstCol || nextCol > lastCol || nextRow < firstRow || nextRow > lastRow)
+					return;
+
+				const int nextLocalIdx{ (nextRow - firstRow) * width + (nextCol - firstCol) };
+				const float costSoFar{ currentRecord.costSoFar + connectionCost };
+				if (costSoFar >= search.distances[nextLocalIdx])
+					return;
+
+				if (openList.Contains(nextLocalIdx))
+					openList.DecreaseKey(nextLocalIdx, ClusterRecord{ nextLocalIdx, costSoFar });
+				else
+					openList.Push(nextLocalIdx, ClusterRecord{ nextLocalIdx, costSoFar });
+				search.distances[nextLocalIdx] = costSoFar;
+			});
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class, class, template<class> class, class> class T_Refiner, template<class> class T_OpenList>
+	float HPAStar<T_NodeType, T_ConnectionType, T_Refiner, T_OpenList>::GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const
+	{
+		Vector2 toDestination = m_pGraph->GetNodePos(pEndNode) - m_pGraph->GetNodePos(pStartNode);
+		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+	}
+}
@@ -0,0 +1,83 @@
+#pragma once
+
+namespace Elite
+{
+	//Heuristic policies of the grid pathfinders (AStar, ThetaStar, LazyThetaStar).
+	//A pathfinder templated on one of the distance policies calls it directly, so the distance is inlined in the search loop
+	//instead of going through the Heuristic function pointer for every node it opens.
+	//Every policy is made from the Heuristic the pathfinder gets, only RuntimeHeuristic uses it: it's the default and
+	//keeps the heuristic selectable at runtime.
+	struct RuntimeHeuristic
+	{
+		explicit RuntimeHeuristic(Heuristic hFunction) : m_HeuristicFunction(hFunction) {}
+		float operator()(float x, float y) const { return m_HeuristicFunction(x, y); }
+
+		Heuristic m_HeuristicFunction;
+	};
+
+	struct ManhattanHeuristic
+	{
+		explicit ManhattanHeuristic(Heuristic = nullptr) {}
+		float operator()(float x, float y) const { return HeuristicFunctions::Manhattan(x, y); }
+	};
+
+	struct EuclideanHeuristic
+	{
+		explicit EuclideanHeuristic(Heuristic = nullptr) {}
+		float operator()(float x, float y) const { return HeuristicFunctions::Euclidean(x, y); }
+	};
+
+	struct SqrtEuclideanHeuristic
+	{
+		explicit SqrtEuclideanHeuristic(Heuristic = nullptr) {}
+		float operator()(float x, float y) const { return HeuristicFunctions::SqrtEuclidean(x, y); }
+	};
+
+	struct OctileHeuristic
+	{
+		explicit OctileHeuristic(Heuristic = nullptr) {}
+		float operator()(float x, float y) const { return HeuristicFunctions::Octile(x, y); }
+	};
+
+	struct ChebyshevHeuristic
+	{
+		explicit ChebyshevHeuristic(Heuristic = nullptr) {}
+		float operator()(float x, float y) const { return (x > y) ? x : y; }
+	};
+
+	//Heuristic cost from a cell of a grid with nrOfColumns columns to the cell at destinationCol, destinationRow.
+	//The pathfinders compute the column and row of the destination once per search, so only the cell itself is converted here,
+	//with one division instead of the modulo and division of the virtual GetNodePos for both cells
+	template <class T_Heuristic>
+	inline float GetGridHeuristicCost(const T_Heuristic& heuristic, int nrOfColumns, int idx, int destinationCol, int destinationRow)
+	{
+		const int row{ idx / nrOfColumns };
+		const int col{ idx - row * nrOfColumns };
+		return heuristic(float(abs(destinationCol - col)), float(abs(destinationRow - row)));
+	}
+
+	//Heuristic cost of the grid searches (AStar, ThetaStar, LazyThetaStar): the grid distance to the destination of the context,
+	//or the landmark estimate when the search has a LandmarkHeuristic and it's larger
+	template <class T_Heuristic, class T_LandmarkHeuristic, class T_Context>
+	inline float GetGridSearchHeuristicCost(const T_Heuristic& heuristic, const T_LandmarkHeuristic* pLandmarkHeuristic, int nrOfColumns, int idx, const T_Context& context)
+	{
+		const float cost{ GetGridHeuristicCost(heuristic, nrOfColumns, idx, context.destinationCol, context.destinationRow) };
+		if (!pLandmarkHeuristic)
+			return cost;
+
+		//Both estimates are lower bounds, the larger one is the better one
+		const float landmarkCost{ pLandmarkHeuristic->GetHeuristicCost(idx, context.destinationIdx) };
+		return (landmarkCost > cost) ? landmarkCost : cost;
+	}
+
+	//True when the cell idx lies within searchRadius cells of startIdx, a radius of 0 or less doesn't limit the search
+	inline bool IsWithinGridSearchRadius(float searchRadius, int nrOfColumns, int idx, int startIdx)
+	{
+		if (searchRadius <= 0.f)
+			return true;
+
+		const float colDistance{ float(idx % nrOfColumns - startIdx % nrOfColumns) };
+		const float rowDistance{ float(idx / nrOfColumns - startIdx / nrOfColumns) };
+		return colDistance * colDistance + rowDistance * rowDistance <= searchRadius * searchRadius;
+	}
+}
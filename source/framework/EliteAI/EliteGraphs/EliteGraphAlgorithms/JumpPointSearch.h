@@ -0,0 +1,436 @@
+#pragma once
+#include "EAStar.h"
+
+namespace Elite
+{
+	//Jump Point Search: A* over the jump points of an 8-connected grid with uniform costs.
+	//Straight and diagonal lines are scanned until a cell with a forced neighbor is found, the symmetric paths in between are never expanded.
+	//JPS+ (useJumpTable) precomputes the jump distance of every cell in all 8 directions, turning each scan into a table lookup.
+	//The jumps are only optimal when every step costs the straight or diagonal cost of the grid, on a grid with terrain costs (mud),
+	//without diagonal connections or with a diagonal cost outside [straight, 2 * straight] the search falls back to AStar.
+	//The search reads the walkable cells of the grid, connections removed by hand between walkable cells aren't seen.
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap>
+	class JumpPointSearch
+	{
+	public:
+		JumpPointSearch(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, bool useJumpTable = false);
+
+		// the records and context are shared with the fallback, so one context can be used by both
+		using Fallback = AStar<T_NodeType, T_ConnectionType, T_OpenList>;
+		using NodeRecord = typename Fallback::NodeRecord;
+		using Context = typename Fallback::Context;
+
+		// the path contains every cell, the cells in between the jump points are filled in
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, no allocations happen once path and the internal context have grown large enough
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// searches with an external context, the pathfinder itself isn't modified
+		// the jump table is only used when it is up to date with the grid, call UpdateJumpTable first
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const;
+
+		// counters of the last search that ran on the internal context, expanded nodes are the expanded jump points
+		const SearchStatistics& GetStatistics() const { return m_Context.statistics; }
+
+		// the graph that is searched, BatchPathfinder and PathRequestService prepare it before their threads search it
+		const GridGraph<T_NodeType, T_ConnectionType>* GetGraph() const { return m_pGraph; }
+
+		// returns false when the grid doesn't allow jumping, FindPath runs AStar then
+		bool CanJump() const;
+
+		void SetUseJumpTable(bool useJumpTable) { m_UseJumpTable = useJumpTable; }
+		bool IsUsingJumpTable() const { return m_UseJumpTable; }
+		// recomputes the JPS+ jump distances if the grid changed since they were computed
+		void UpdateJumpTable();
+
+	private:
+		enum { nrOfDirections = 8 };
+
+		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
+
+		bool IsWalkable(int col, int row) const;
+		bool HasForcedNeighbor(int col, int row, int dirCol, int dirRow) const;
+		static int GetDirectionIndex(int dirCol, int dirRow);
+
+		// calls function(int jumpPointIdx, float cost) for every jump point reachable from the record
+		template<typename T_Function>
+		void ForEachJumpPoint(const NodeRecord& nodeRecord, T_NodeType* pDestinationNode, bool useJumpTable, T_Function&& function) const;
+		// both return the index of the first jump point in the direction, or invalid_node_index
+		int Jump(int col, int row, int dirCol, int dirRow, int destCol, int destRow) const;
+		int JumpWithTable(int col, int row, int dirCol, int dirRow, int destCol, int destRow) const;
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		Heuristic m_HeuristicFunction;
+		Fallback m_Fallback;
+
+		// reused by every search started without an external context
+		Context m_Context;
+
+		// per cell and direction: > 0 is the distance to the next jump point, <= 0 is minus the distance to the last walkable cell
+		std::vector<int> m_JumpDistances;
+		unsigned int m_JumpTableVersion;
+		bool m_HasJumpTable;
+		bool m_UseJumpTable;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::JumpPointSearch(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction, bool useJumpTable)
+		: m_pGraph(pGraph)
+		, m_HeuristicFunction(hFunction)
+		, m_Fallback(pGraph, hFunction)
+		, m_JumpTableVersion(0)
+		, m_HasJumpTable(false)
+		, m_UseJumpTable(useJumpTable)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	std::vector<T_NodeType*> JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		if (m_UseJumpTable && CanJump())
+			UpdateJumpTable();
+
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const
+	{
+		if (!CanJump())
+		{
+			m_Fallback.FindPath(pStartNode, pDestinationNode, path, context);
+			return;
+		}
+
+		//The component labels tell right away if the destination can't be reached, the search runs to the closest cell it can reach then
+		if (!m_pGraph->AreConnected(pStartNode->GetIndex(), pDestinationNode->GetIndex()))
+			pDestinationNode = m_pGraph->GetNode(m_pGraph->GetClosestConnectedCell(pStartNode->GetIndex(), pDestinationNode->GetIndex()));
+
+		const bool useJumpTable{ m_UseJumpTable && m_HasJumpTable && m_JumpTableVersion == m_pGraph->GetVersion() };
+
+		auto& openList{ context.openList };
+		auto& closedList{ context.closedList };
+		context.Reset(m_pGraph->GetNrOfNodes());
+		NodeRecord currentNodeRecord;
+
+		path.clear();
+		bool pathFound = false;
+
+		openList.Push(pStartNode->GetIndex(), NodeRecord{ pStartNode->GetIndex(), invalid_node_index, 0.f, GetHeuristicCost(pStartNode, pDestinationNode) });
+		while (!openList.Empty() && !pathFound)
+		{
+			currentNodeRecord = openList.Pop();
+			closedList.Add(currentNodeRecord.nodeIdx, currentNodeRecord);
+			++context.statistics.nrOfExpandedNodes;
+			context.UpdateClosestNode(currentNodeRecord.nodeIdx, currentNodeRecord.estimatedTotalCost - currentNodeRecord.costSoFar);
+
+			if (currentNodeRecord.nodeIdx != pDestinationNode->GetIndex())
+			{
+				ForEachJumpPoint(currentNodeRecord, pDestinationNode, useJumpTable, [&](int nextIdx, float jumpCost)
+				{
+					if (closedList.Contains(nextIdx))
+						return;
+
+					T_NodeType* nextNode{ m_pGraph->GetNode(nextIdx) };
+					float costSoFar{ currentNodeRecord.costSoFar + jumpCost };
+					if (!openList.Contains(nextIdx))
+					{
+						openList.Push(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, costSoFar + GetHeuristicCost(nextNode, pDestinationNode) });
+					}
+					else if (openList.Get(nextIdx).costSoFar > costSoFar)
+					{
+						openList.DecreaseKey(nextIdx, NodeRecord{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, costSoFar + GetHeuristicCost(nextNode, pDestinationNode) });
+					}
+				});
+			}
+			else
+				pathFound = true;
+		}
+
+		//If the path isn't found, it goes to the expanded jump point closest to the destination like AStar does (the start is always expanded)
+		if (!pathFound)
+			currentNodeRecord = closedList.Get(context.closestIdx);
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		while (currentNodeRecord.nodeIdx != pStartNode->GetIndex())
+		{
+			//Jump points are connected by a straight or diagonal line, walk it back to the parent
+			int idx{ currentNodeRecord.nodeIdx };
+			int parentIdx{ currentNodeRecord.parentIdx };
+			int stepCol{ (parentIdx % nrOfColumns > idx % nrOfColumns) - (parentIdx % nrOfColumns < idx % nrOfColumns) };
+			int stepRow{ (parentIdx / nrOfColumns > idx / nrOfColumns) - (parentIdx / nrOfColumns < idx / nrOfColumns) };
+			for (; idx != parentIdx; idx += stepRow * nrOfColumns + stepCol)
+				path.push_back(m_pGraph->GetNode(idx));
+
+			currentNodeRecord = closedList.Get(parentIdx);
+		}
+		path.push_back(pStartNode);
+		std::reverse(path.begin(), path.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::CanJump() const
+	{
+		const float costStraight{ m_pGraph->GetCostStraight() };
+		const float costDiagonal{ m_pGraph->GetCostDiagonal() };
+
+		return m_pGraph->IsConnectedDiagonally()
+			&& m_pGraph->HasUniformTerrain()
+			&& costDiagonal >= costStraight
+			&& costDiagonal <= 2.f * costStraight;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	void JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::UpdateJumpTable()
+	{
+		if (m_HasJumpTable && m_JumpTableVersion == m_pGraph->GetVersion())
+			return;
+
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		const int nrOfRows{ m_pGraph->GetRows() };
+		m_JumpDistances.resize(size_t(nrOfColumns) * nrOfRows * nrOfDirections);
+
+		//Same direction order as GetDirectionIndex, the diagonals use the straight distances so those come first
+		const int directionCols[nrOfDirections]{ 1, 0, -1, 0, 1, -1, -1, 1 };
+		const int directionRows[nrOfDirections]{ 0, 1, 0, -1, 1, 1, -1, -1 };
+		for (int d = 0; d < nrOfDirections; ++d)
+		{
+			const int dirCol{ directionCols[d] };
+			const int dirRow{ directionRows[d] };
+			const bool isDiagonal{ dirCol != 0 && dirRow != 0 };
+
+			//Visit the cells against the direction, so the next cell on the line is always done already
+			for (int r = 0; r < nrOfRows; ++r)
+			{
+				const int row{ (dirRow > 0) ? nrOfRows - 1 - r : r };
+				for (int c = 0; c < nrOfColumns; ++c)
+				{
+					const int col{ (dirCol > 0) ? nrOfColumns - 1 - c : c };
+					const int nextCol{ col + dirCol };
+					const int nextRow{ row + dirRow };
+
+					int distance{ 0 };
+					if (IsWalkable(nextCol, nextRow))
+					{
+						const int nextIdx{ m_pGraph->GetIndex(nextCol, nextRow) };
+						bool isJumpPoint{ HasForcedNeighbor(nextCol, nextRow, dirCol, dirRow) };
+						if (isDiagonal && !isJumpPoint)
+						{
+							isJumpPoint = m_JumpDistances[nextIdx * nrOfDirections + GetDirectionIndex(dirCol, 0)] > 0
+								|| m_JumpDistances[nextIdx * nrOfDirections + GetDirectionIndex(0, dirRow)] > 0;
+						}
+
+						if (isJumpPoint)
+							distance = 1;
+						else
+						{
+							const int nextDistance{ m_JumpDistances[nextIdx * nrOfDirections + d] };
+							distance = (nextDistance > 0) ? nextDistance + 1 : nextDistance - 1;
+						}
+					}
+
+					m_JumpDistances[m_pGraph->GetIndex(col, row) * nrOfDirections + d] = distance;
+				}
+			}
+		}
+
+		m_JumpTableVersion = m_pGraph->GetVersion();
+		m_HasJumpTable = true;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	template<typename T_Function>
+	void JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::ForEachJumpPoint(const NodeRecord& nodeRecord, T_NodeType* pDestinationNode, bool useJumpTable, T_Function&& function) const
+	{
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		const int idx{ nodeRecord.nodeIdx };
+		const int col{ idx % nrOfColumns };
+		const int row{ idx / nrOfColumns };
+		const int destCol{ pDestinationNode->GetIndex() % nrOfColumns };
+		const int destRow{ pDestinationNode->GetIndex() / nrOfColumns };
+
+		//An isolated start has no connections to jump along
+		if (!m_pGraph->IsWalkable(idx))
+			return;
+
+		//Prune the neighbors: only the natural neighbors in the direction of travel and the forced neighbors are scanned
+		int directions[nrOfDirections][2];
+		int nrOfScans{ 0 };
+		if (nodeRecord.parentIdx == invalid_node_index)
+		{
+			for (int dirRow = -1; dirRow <= 1; ++dirRow)
+			{
+				for (int dirCol = -1; dirCol <= 1; ++dirCol)
+				{
+					if (dirCol == 0 && dirRow == 0)
+						continue;
+
+					directions[nrOfScans][0] = dirCol;
+					directions[nrOfScans++][1] = dirRow;
+				}
+			}
+		}
+		else
+		{
+			const int parentIdx{ nodeRecord.parentIdx };
+			const int dirCol{ (col > parentIdx % nrOfColumns) - (col < parentIdx % nrOfColumns) };
+			const int dirRow{ (row > parentIdx / nrOfColumns) - (row < parentIdx / nrOfColumns) };
+			auto addDirection = [&](int scanCol, int scanRow)
+			{
+				directions[nrOfScans][0] = scanCol;
+				directions[nrOfScans++][1] = scanRow;
+			};
+
+			if (dirCol != 0 && dirRow != 0)
+			{
+				addDirection(dirCol, 0);
+				addDirection(0, dirRow);
+				addDirection(dirCol, dirRow);
+				if (!IsWalkable(col - dirCol, row))
+					addDirection(-dirCol, dirRow);
+				if (!IsWalkable(col, row - dirRow))
+					addDirection(dirCol, -dirRow);
+			}
+			else if (dirCol != 0)
+			{
+				addDirection(dirCol, 0);
+				if (!IsWalkable(col, row + 1))
+					addDirection(dirCol, 1);
+				if (!IsWalkable(col, row - 1))
+					addDirection(dirCol, -1);
+			}
+			else
+			{
+				addDirection(0, dirRow);
+				if (!IsWalkable(col + 1, row))
+					addDirection(1, dirRow);
+				if (!IsWalkable(col - 1, row))
+					addDirection(-1, dirRow);
+			}
+		}
+
+		for (int scan = 0; scan < nrOfScans; ++scan)
+		{
+			const int dirCol{ directions[scan][0] };
+			const int dirRow{ directions[scan][1] };
+			const int jumpPointIdx{ useJumpTable
+				? JumpWithTable(col, row, dirCol, dirRow, destCol, destRow)
+				: Jump(col, row, dirCol, dirRow, destCol, destRow) };
+
+			if (jumpPointIdx == invalid_node_index)
+				continue;
+
+			const int deltaCol{ abs(jumpPointIdx % nrOfColumns - col) };
+			const int deltaRow{ abs(jumpPointIdx / nrOfColumns - row) };
+			if (dirCol != 0 && dirRow != 0)
+				function(jumpPointIdx, deltaCol * m_pGraph->GetCostDiagonal());
+			else
+				function(jumpPointIdx, (deltaCol + deltaRow) * m_pGraph->GetCostStraight());
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	int JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::Jump(int col, int row, int dirCol, int dirRow, int destCol, int destRow) const
+	{
+		while (true)
+		{
+			col += dirCol;
+			row += dirRow;
+			if (!IsWalkable(col, row))
+				return invalid_node_index;
+
+			if ((col == destCol && row == destRow) || HasForcedNeighbor(col, row, dirCol, dirRow))
+				return m_pGraph->GetIndex(col, row);
+
+			//A diagonal cell is a jump point as well when one of its straight scans finds one
+			if (dirCol != 0 && dirRow != 0
+				&& (Jump(col, row, dirCol, 0, destCol, destRow) != invalid_node_index || Jump(col, row, 0, dirRow, destCol, destRow) != invalid_node_index))
+				return m_pGraph->GetIndex(col, row);
+		}
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	int JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::JumpWithTable(int col, int row, int dirCol, int dirRow, int destCol, int destRow) const
+	{
+		const int distance{ m_JumpDistances[m_pGraph->GetIndex(col, row) * nrOfDirections + GetDirectionIndex(dirCol, dirRow)] };
+		const int reach{ abs(distance) };
+		const int deltaCol{ destCol - col };
+		const int deltaRow{ destRow - row };
+
+		//The destination isn't in the table, stop on it (or on the diagonal cell sharing its row or column) when it lies within reach
+		int stepsToDestination{ 0 };
+		if (dirCol != 0 && dirRow != 0)
+		{
+			if (deltaCol * dirCol > 0 && deltaRow * dirRow > 0)
+				stepsToDestination = (abs(deltaCol) < abs(deltaRow)) ? abs(deltaCol) : abs(deltaRow);
+		}
+		else if (dirCol != 0)
+		{
+			if (deltaRow == 0 && deltaCol * dirCol > 0)
+				stepsToDestination = abs(deltaCol);
+		}
+		else if (deltaCol == 0 && deltaRow * dirRow > 0)
+			stepsToDestination = abs(deltaRow);
+
+		if (stepsToDestination > 0 && stepsToDestination <= reach)
+			return m_pGraph->GetIndex(col + stepsToDestination * dirCol, row + stepsToDestination * dirRow);
+
+		if (distance > 0)
+			return m_pGraph->GetIndex(col + distance * dirCol, row + distance * dirRow);
+
+		return invalid_node_index;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::HasForcedNeighbor(int col, int row, int dirCol, int dirRow) const
+	{
+		//A neighbor is forced when the blocked cell next to the line means it can't be reached as cheap without passing this cell
+		if (dirCol != 0 && dirRow != 0)
+		{
+			return (!IsWalkable(col - dirCol, row) && IsWalkable(col - dirCol, row + dirRow))
+				|| (!IsWalkable(col, row - dirRow) && IsWalkable(col + dirCol, row - dirRow));
+		}
+
+		if (dirCol != 0)
+		{
+			return (!IsWalkable(col, row + 1) && IsWalkable(col + dirCol, row + 1))
+				|| (!IsWalkable(col, row - 1) && IsWalkable(col + dirCol, row - 1));
+		}
+
+		return (!IsWalkable(col + 1, row) && IsWalkable(col + 1, row + dirRow))
+			|| (!IsWalkable(col - 1, row) && IsWalkable(col - 1, row + dirRow));
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	bool JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::IsWalkable(int col, int row) const
+	{
+		return m_pGraph->IsWithinBounds(col, row) && m_pGraph->IsWalkable(m_pGraph->GetIndex(col, row));
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	int JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::GetDirectionIndex(int dirCol, int dirRow)
+	{
+		//Straight directions first, in the same order as the grid adds its connections
+		if (dirRow == 0)
+			return (dirCol > 0) ? 0 : 2;
+		if (dirCol == 0)
+			return (dirRow > 0) ? 1 : 3;
+		if (dirRow > 0)
+			return (dirCol > 0) ? 4 : 5;
+		return (dirCol < 0) ? 6 : 7;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList>
+	float JumpPointSearch<T_NodeType, T_ConnectionType, T_OpenList>::GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const
+	{
+		Vector2 toDestination = m_pGraph->GetNodePos(pEndNode) - m_pGraph->GetNodePos(pStartNode);
+		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+	}
+}
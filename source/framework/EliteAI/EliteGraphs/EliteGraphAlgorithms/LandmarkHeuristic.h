@@ -0,0 +1,236 @@
+#pragma once
+#include "../EGridGraph.h"
+#include "PriorityQueues.h"
+
+namespace Elite
+{
+	//ALT heuristic (A*, Landmarks, Triangle inequality): exact distances from a few landmark nodes to every node are precomputed with
+	//Dijkstra sweeps over the graph. For any landmark L the triangle inequality gives |d(L, goal) - d(L, node)| <= d(node, goal),
+	//the largest of these bounds is the estimate. Walls and terrain costs are part of the distances, so the estimate stays informed
+	//on maze-like maps where the geometric heuristics are far too low.
+	//The landmarks are spread over the largest connected part of the graph with farthest point selection: every next landmark is the
+	//node farthest from the ones chosen before. Nodes in other parts get an estimate of 0, like nodes no landmark can reach.
+	//Distances are stored as 16 bit fixed point numbers per landmark. They are rounded down and the estimate subtracts one step,
+	//so it never overestimates a distance of the graph the tables were computed on. Call Update after editing the graph.
+	//The graph has to be undirected, d(L, node) is used for both directions.
+	template<class T_NodeType, class T_ConnectionType>
+	class LandmarkHeuristic
+	{
+	public:
+		explicit LandmarkHeuristic(const GridGraph<T_NodeType, T_ConnectionType>* pGraph, int nrOfLandmarks = 8);
+
+		float GetHeuristicCost(int fromIdx, int toIdx) const;
+
+		// recomputes the distance tables if the graph changed since they were computed
+		void Update();
+		bool IsUpToDate() const { return m_Version == m_pGraph->GetVersion(); }
+
+		int GetNrOfLandmarks() const { return int(m_Landmarks.size()); }
+		const std::vector<int>& GetLandmarks() const { return m_Landmarks; }
+
+	private:
+		struct SweepRecord
+		{
+			int nodeIdx = invalid_node_index;
+			float costSoFar = 0.f;
+
+			bool operator<(const SweepRecord& other) const { return costSoFar < other.costSoFar; }
+		};
+
+		enum : uint16_t { Unreachable = 0xFFFF, MaxStoredDistance = 0xFFFE };
+
+		void Build();
+		// Dijkstra from the landmark over the whole graph, FLT_MAX for the nodes it can't reach
+		void Sweep(int landmarkIdx, std::vector<float>& distances);
+
+		const GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		int m_MaxNrOfLandmarks;
+		unsigned int m_Version;
+
+		std::vector<int> m_Landmarks;
+		std::vector<float> m_StepSizes; // distance of one fixed point step, per landmark
+		std::vector<uint16_t> m_Distances; // m_Distances[nodeIdx * m_MaxNrOfLandmarks + landmark], the distances of a node are next to each other
+
+		// scratch buffers of the sweeps
+		BinaryHeap<SweepRecord> m_OpenList;
+		std::vector<float> m_SweepDistances;
+		std::vector<float> m_ClosestLandmarkDistances;
+	};
+
+	template<class T_NodeType, class T_ConnectionType>
+	LandmarkHeuristic<T_NodeType, T_ConnectionType>::LandmarkHeuristic(const GridGraph<T_NodeType, T_ConnectionType>* pGraph, int nrOfLandmarks)
+		: m_pGraph(pGraph)
+		, m_MaxNrOfLandmarks(nrOfLandmarks)
+		, m_Version(pGraph->GetVersion())
+	{
+		assert(nrOfLandmarks > 0 && "<LandmarkHeuristic>: needs at least one landmark");
+		assert(!pGraph->IsDirectionalGraph() && "<LandmarkHeuristic>: the distance tables are only valid in both directions for an undirected graph");
+
+		Build();
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline float LandmarkHeuristic<T_NodeType, T_ConnectionType>::GetHeuristicCost(int fromIdx, int toIdx) const
+	{
+		const int nrOfLandmarks{ int(m_Landmarks.size()) };
+		if (nrOfLandmarks == 0)
+			return 0.f;
+
+		const uint16_t* pFromDistances{ &m_Distances[size_t(fromIdx) * m_MaxNrOfLandmarks] };
+		const uint16_t* pToDistances{ &m_Distances[size_t(toIdx) * m_MaxNrOfLandmarks] };
+
+		float bestCost{ 0.f };
+		for (int landmark{ 0 }; landmark < nrOfLandmarks; ++landmark)
+		{
+			//A landmark that can't reach both nodes says nothing about their distance
+			if (pFromDistances[landmark] == Unreachable || pToDistances[landmark] == Unreachable)
+				continue;
+
+			const int difference{ abs(int(pFromDistances[landmark]) - int(pToDistances[landmark])) };
+			const float cost{ float(difference - 1) * m_StepSizes[landmark] };
+			if (cost > bestCost)
+				bestCost = cost;
+		}
+
+		return bestCost;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void LandmarkHeuristic<T_NodeType, T_ConnectionType>::Update()
+	{
+		if (IsUpToDate())
+			return;
+
+		Build();
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void LandmarkHeuristic<T_NodeType, T_ConnectionType>::Build()
+	{
+		const int nrOfNodes{ m_pGraph->GetNrOfNodes() };
+		m_Landmarks.clear();
+		m_StepSizes.clear();
+		m_Version = m_pGraph->GetVersion();
+
+		//Find the largest connected part: sweep from walkable nodes no sweep reached yet, until one part holds at least half of them
+		int nrOfWalkableNodes{ 0 };
+		for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+			nrOfWalkableNodes += m_pGraph->IsWalkable(idx) ? 1 : 0;
+
+		m_ClosestLandmarkDistances.assign(nrOfNodes, FLT_MAX); // marks the nodes a sweep reached until the landmarks are placed
+		int largestPartIdx{ invalid_node_index };
+		int largestPartSize{ 0 };
+		int lastSweepIdx{ invalid_node_index };
+		for (int idx{ 0 }; idx < nrOfNodes && largestPartSize * 2 < nrOfWalkableNodes; ++idx)
+		{
+			if (!m_pGraph->IsWalkable(idx) || m_ClosestLandmarkDistances[idx] != FLT_MAX)
+				continue;
+
+			Sweep(idx, m_SweepDistances);
+			lastSweepIdx = idx;
+			int partSize{ 0 };
+			for (int reachedIdx{ 0 }; reachedIdx < nrOfNodes; ++reachedIdx)
+			{
+				if (m_SweepDistances[reachedIdx] == FLT_MAX)
+					continue;
+
+				m_ClosestLandmarkDistances[reachedIdx] = 0.f;
+				++partSize;
+			}
+
+			if (partSize > largestPartSize)
+			{
+				largestPartSize = partSize;
+				largestPartIdx = idx;
+			}
+		}
+
+		if (largestPartIdx == invalid_node_index)
+			return;
+
+		//The farthest node from a node of the part is the first landmark
+		if (largestPartIdx != lastSweepIdx)
+			Sweep(largestPartIdx, m_SweepDistances);
+
+		int nextLandmarkIdx{ invalid_node_index };
+		m_ClosestLandmarkDistances.assign(nrOfNodes, FLT_MAX);
+		m_Distances.assign(size_t(nrOfNodes) * m_MaxNrOfLandmarks, uint16_t(Unreachable));
+		while (int(m_Landmarks.size()) < m_MaxNrOfLandmarks)
+		{
+			//Farthest node of the part from the first sweep (or from all landmarks so far)
+			float farthestDistance{ -1.f };
+			nextLandmarkIdx = invalid_node_index;
+			const std::vector<float>& distances{ m_Landmarks.empty() ? m_SweepDistances : m_ClosestLandmarkDistances };
+			for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+			{
+				if (distances[idx] == FLT_MAX || distances[idx] <= farthestDistance)
+					continue;
+
+				if (!m_Landmarks.empty() && std::find(m_Landmarks.cbegin(), m_Landmarks.cend(), idx) != m_Landmarks.cend())
+					continue;
+
+				farthestDistance = distances[idx];
+				nextLandmarkIdx = idx;
+			}
+
+			if (nextLandmarkIdx == invalid_node_index)
+				break;
+
+			Sweep(nextLandmarkIdx, m_SweepDistances);
+
+			float maxDistance{ 0.f };
+			for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+			{
+				const float distance{ m_SweepDistances[idx] };
+				if (distance == FLT_MAX)
+					continue;
+
+				if (distance > maxDistance)
+					maxDistance = distance;
+				if (distance < m_ClosestLandmarkDistances[idx])
+					m_ClosestLandmarkDistances[idx] = distance;
+			}
+
+			//Round down to whole steps, the estimate compensates for the lost fraction
+			const size_t landmark{ m_Landmarks.size() };
+			const float stepSize{ (maxDistance > 0.f) ? maxDistance / float(MaxStoredDistance) : 1.f };
+			for (int idx{ 0 }; idx < nrOfNodes; ++idx)
+			{
+				const float steps{ m_SweepDistances[idx] / stepSize };
+				if (m_SweepDistances[idx] != FLT_MAX)
+					m_Distances[size_t(idx) * m_MaxNrOfLandmarks + landmark] = uint16_t((steps < float(MaxStoredDistance)) ? steps : float(MaxStoredDistance));
+			}
+
+			m_Landmarks.push_back(nextLandmarkIdx);
+			m_StepSizes.push_back(stepSize);
+		}
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void LandmarkHeuristic<T_NodeType, T_ConnectionType>::Sweep(int landmarkIdx, std::vector<float>& distances)
+	{
+		const int nrOfNodes{ m_pGraph->GetNrOfNodes() };
+		distances.assign(nrOfNodes, FLT_MAX);
+		m_OpenList.Clear();
+		m_OpenList.Reserve(nrOfNodes);
+
+		distances[landmarkIdx] = 0.f;
+		m_OpenList.Push(landmarkIdx, SweepRecord{ landmarkIdx, 0.f });
+		while (!m_OpenList.Empty())
+		{
+			const SweepRecord currentRecord{ m_OpenList.Pop() };
+			m_pGraph->ForEachNeighbor(currentRecord.nodeIdx, [&](int nextIdx, float connectionCost)
+			{
+				const float costSoFar{ currentRecord.costSoFar + connectionCost };
+				if (costSoFar >= distances[nextIdx])
+					return;
+
+				if (m_OpenList.Contains(nextIdx))
+					m_OpenList.DecreaseKey(nextIdx, SweepRecord{ nextIdx, costSoFar });
+				else
+					m_OpenList.Push(nextIdx, SweepRecord{ nextIdx, costSoFar });
+				distances[nextIdx] = costSoFar;
+			});
+		}
+	}
+}
@@ -0,0 +1,281 @@
+#pragma once
+#include "ThetaStar.h"
+
+namespace Elite
+{
+	//Lazy Theta*: Theta* with the line of sight checks delayed until a node is expanded.
+	//A generated neighbor is linked to the parent of the expanded node assuming there is a line of sight, the assumption is only verified
+	//once the neighbor itself gets expanded. If it doesn't hold, the neighbor gets its best closed neighbor as parent instead.
+	//Most generated nodes are never expanded, so far less line of sight checks are done than with Theta*.
+	//T_OpenList and T_Heuristic: see ThetaStar
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap, class T_Heuristic = RuntimeHeuristic>
+	class LazyThetaStar
+	{
+	public:
+		LazyThetaStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction);
+
+		// same records as ThetaStar, so one context can be used by both
+		using NodeRecord = typename ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::NodeRecord;
+		using Context = typename ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::Context;
+
+		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, no allocations happen once path and the internal context have grown large enough
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// searches with an external context, the pathfinder itself isn't modified
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const;
+
+		// time sliced search, see AStar::BeginSearch
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode, Context& context) const;
+		SearchStatus Step(int maxExpansions, Context& context) const;
+		SearchStatus StepFor(int maxMicroseconds, Context& context) const;
+		void GetPath(std::vector<T_NodeType*>& path, const Context& context) const;
+
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode) { BeginSearch(pStartNode, pDestinationNode, m_Context); }
+		SearchStatus Step(int maxExpansions) { return Step(maxExpansions, m_Context); }
+		SearchStatus StepFor(int maxMicroseconds) { return StepFor(maxMicroseconds, m_Context); }
+		void GetPath(std::vector<T_NodeType*>& path) const { GetPath(path, m_Context); }
+
+		// counters of the last search that ran on the internal context
+		const SearchStatistics& GetStatistics() const { return m_Context.statistics; }
+
+		// the graph that is searched, BatchPathfinder and PathRequestService prepare it before their threads search it
+		const GridGraph<T_NodeType, T_ConnectionType>* GetGraph() const { return m_pGraph; }
+
+		// optional, see ThetaStar::SetLineOfSightCache
+		void SetLineOfSightCache(LineOfSightCache<T_NodeType, T_ConnectionType>* pCache) { m_pLineOfSightCache = pCache; }
+		// optional, see ThetaStar::SetLandmarkHeuristic
+		void SetLandmarkHeuristic(const LandmarkHeuristic<T_NodeType, T_ConnectionType>* pLandmarks) { m_pLandmarkHeuristic = pLandmarks; }
+
+		// optional bounds for searches that would take too long, 0 turns them off
+		// a search that runs into them ends as Failed, with the path to the closest node to the destination it expanded
+		void SetMaxNrOfExpansions(int maxNrOfExpansions) { m_MaxNrOfExpansions = maxNrOfExpansions; }
+		// nodes further than the radius (in cells) from the start are never opened
+		void SetSearchRadius(float searchRadius) { m_SearchRadius = searchRadius; }
+
+	private:
+		enum { ClockCheckInterval = 16 };
+
+		template <class T_Function>
+		SearchStatus Expand(Context& context, T_Function&& isOutOfBudget) const;
+		float GetHeuristicCost(int nodeIdx, const Context& context) const;
+		bool IsWithinSearchRadius(int idx, int startIdx) const;
+		// verifies the assumed line of sight of a node that is about to be expanded, repairs its parent if there is none
+		void SetVertex(NodeRecord& nodeRecord, Context& context) const;
+
+		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		T_Heuristic m_Heuristic;
+		LineOfSightCache<T_NodeType, T_ConnectionType>* m_pLineOfSightCache = nullptr;
+		const LandmarkHeuristic<T_NodeType, T_ConnectionType>* m_pLandmarkHeuristic = nullptr;
+		int m_MaxNrOfExpansions = 0;
+		float m_SearchRadius = 0.f;
+
+		// reused by every search started without an external context
+		Context m_Context;
+	};
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::LazyThetaStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+		: m_pGraph(pGraph)
+		, m_Heuristic(hFunction)
+	{
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	std::vector<T_NodeType*> LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	{
+		vector<T_NodeType*> path{};
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+
+		return path;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const
+	{
+		BeginSearch(pStartNode, pDestinationNode, context);
+		Expand(context, [](int) { return false; });
+		GetPath(path, context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode, Context& context) const
+	{
+		context.Reset(m_pGraph->GetNrOfNodes());
+		context.startIdx = pStartNode->GetIndex();
+		context.status = SearchStatus::InProgress;
+
+		//The component labels tell right away if the destination can't be reached, the search runs to the closest cell it can reach then
+		context.isDestinationReachable = pStartNode == pDestinationNode || m_pGraph->AreConnected(context.startIdx, pDestinationNode->GetIndex());
+		context.destinationIdx = context.isDestinationReachable ? pDestinationNode->GetIndex() : m_pGraph->GetClosestConnectedCell(context.startIdx, pDestinationNode->GetIndex());
+		context.destinationCol = context.destinationIdx % m_pGraph->GetColumns();
+		context.destinationRow = context.destinationIdx / m_pGraph->GetColumns();
+
+		context.openList.Push(context.startIdx, NodeRecord{ context.startIdx, invalid_node_index, 0.f, GetHeuristicCost(context.startIdx, context) });
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	SearchStatus LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::Step(int maxExpansions, Context& context) const
+	{
+		return Expand(context, [maxExpansions](int nrOfExpansions) { return nrOfExpansions >= maxExpansions; });
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	SearchStatus LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::StepFor(int maxMicroseconds, Context& context) const
+	{
+		const auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(maxMicroseconds);
+		return Expand(context, [&endTime](int nrOfExpansions)
+		{
+			return (nrOfExpansions % ClockCheckInterval) == 0 && std::chrono::high_resolution_clock::now() >= endTime;
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::GetPath(std::vector<T_NodeType*>& path, const Context& context) const
+	{
+		const auto& closedList{ context.closedList };
+		path.clear();
+
+		//If the search didn't get there (yet), the path goes to the closest node it expanded, the start when it didn't expand any
+		const int lastIdx{ closedList.Contains(context.destinationIdx) ? context.destinationIdx : context.closestIdx };
+		for (int idx{ (lastIdx != invalid_node_index) ? lastIdx : context.startIdx }; idx != context.startIdx; idx = closedList.Get(idx).parentIdx)
+			path.push_back(m_pGraph->GetNode(idx));
+		path.push_back(m_pGraph->GetNode(context.startIdx));
+		std::reverse(path.begin(), path.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	template <class T_Function>
+	SearchStatus LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::Expand(Context& context, T_Function&& isOutOfBudget) const
+	{
+		if (context.status != SearchStatus::InProgress)
+			return context.status;
+
+		auto& openList{ context.openList };
+		auto& closedList{ context.closedList };
+
+		int nrOfExpansions{ 0 };
+		while (!openList.Empty())
+		{
+			if (isOutOfBudget(nrOfExpansions))
+				return SearchStatus::InProgress;
+
+			if (m_MaxNrOfExpansions > 0 && context.statistics.nrOfExpandedNodes >= m_MaxNrOfExpansions)
+				break;
+
+			NodeRecord currentNodeRecord{ openList.Pop() };
+			SetVertex(currentNodeRecord, context);
+			closedList.Add(currentNodeRecord.nodeIdx, currentNodeRecord);
+			++context.statistics.nrOfExpandedNodes;
+			++nrOfExpansions;
+
+			const float heuristicCost{ currentNodeRecord.estimatedTotalCost - currentNodeRecord.costSoFar };
+			context.UpdateClosestNode(currentNodeRecord.nodeIdx, heuristicCost);
+
+			if (currentNodeRecord.nodeIdx == context.destinationIdx)
+			{
+				context.status = context.isDestinationReachable ? SearchStatus::Found : SearchStatus::Failed;
+				return context.status;
+			}
+
+			m_pGraph->ForEachNeighbor(currentNodeRecord.nodeIdx, [&](int nextIdx, float connectionCost)
+			{
+				if (closedList.Contains(nextIdx) || !IsWithinSearchRadius(nextIdx, context.startIdx))
+					return;
+
+				NodeRecord nr{ nextIdx, currentNodeRecord.nodeIdx, currentNodeRecord.costSoFar + connectionCost, 0.f };
+
+				//Take the straight line from the parent without checking it, SetVertex does when the node is expanded
+				if (currentNodeRecord.parentIdx != invalid_node_index)
+				{
+					const NodeRecord& parentNr{ closedList.Get(currentNodeRecord.parentIdx) };
+					Vector2 toNext = m_pGraph->GetNodePos(nextIdx) - m_pGraph->GetNodePos(parentNr.nodeIdx);
+					float newCostSoFar{ parentNr.costSoFar + HeuristicFunctions::Euclidean(abs(toNext.x), abs(toNext.y)) };
+					if (newCostSoFar <= nr.costSoFar) // same preference for the straight line as ThetaStar::UpdateNode
+					{
+						nr.parentIdx = parentNr.nodeIdx;
+						nr.costSoFar = newCostSoFar;
+					}
+				}
+				nr.estimatedTotalCost = nr.costSoFar + GetHeuristicCost(nextIdx, context);
+
+				if (!openList.Contains(nextIdx))
+				{
+					openList.Push(nextIdx, nr);
+				}
+				else if (openList.Get(nextIdx).costSoFar > nr.costSoFar)
+				{
+					openList.DecreaseKey(nextIdx, nr);
+				}
+			});
+		}
+
+		context.status = SearchStatus::Failed;
+		return context.status;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::SetVertex(NodeRecord& nodeRecord, Context& context) const
+	{
+		if (nodeRecord.parentIdx == invalid_node_index)
+			return;
+
+		//Adjacent cells see each other when they are connected, only longer lines need the full line of sight check
+		Vector2 toParent = m_pGraph->GetNodePos(nodeRecord.parentIdx) - m_pGraph->GetNodePos(nodeRecord.nodeIdx);
+		bool hasLineOfSight{};
+		if (abs(toParent.x) <= 1.f && abs(toParent.y) <= 1.f)
+			hasLineOfSight = m_pGraph->AreAdjacentCellsConnected(nodeRecord.parentIdx, nodeRecord.nodeIdx);
+		else
+		{
+			++context.statistics.nrOfLineOfSightChecks;
+			T_NodeType* pParent{ m_pGraph->GetNode(nodeRecord.parentIdx) };
+			T_NodeType* pNode{ m_pGraph->GetNode(nodeRecord.nodeIdx) };
+			hasLineOfSight = m_pLineOfSightCache ? m_pLineOfSightCache->HasLineOfSight(pParent, pNode)
+				: PathFindingUtils::HasLineOfSight(m_pGraph, pParent, pNode);
+		}
+
+		if (hasLineOfSight)
+			return;
+
+		//Fall back to the cheapest path through a closed neighbor, the one that generated the node is always one of them
+		//Grid connections are symmetric so the connection to the neighbor has the cost of the one coming from it
+		const auto& closedList{ context.closedList };
+		int bestParentIdx{ invalid_node_index };
+		float bestCostSoFar{ FLT_MAX };
+		m_pGraph->ForEachNeighbor(nodeRecord.nodeIdx, [&](int neighborIdx, float connectionCost)
+		{
+			if (!closedList.Contains(neighborIdx))
+				return;
+
+			float costSoFar{ closedList.Get(neighborIdx).costSoFar + connectionCost };
+			if (costSoFar < bestCostSoFar)
+			{
+				bestCostSoFar = costSoFar;
+				bestParentIdx = neighborIdx;
+			}
+		});
+
+		assert(bestParentIdx != invalid_node_index && "<LazyThetaStar::SetVertex>: expanded node has no closed neighbor");
+
+		nodeRecord.estimatedTotalCost += bestCostSoFar - nodeRecord.costSoFar;
+		nodeRecord.costSoFar = bestCostSoFar;
+		nodeRecord.parentIdx = bestParentIdx;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	inline float LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::GetHeuristicCost(int nodeIdx, const Context& context) const
+	{
+		return GetGridSearchHeuristicCost(m_Heuristic, m_pLandmarkHeuristic, m_pGraph->GetColumns(), nodeIdx, context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	inline bool LazyThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::IsWithinSearchRadius(int idx, int startIdx) const
+	{
+		return IsWithinGridSearchRadius(m_SearchRadius, m_pGraph->GetColumns(), idx, startIdx);
+	}
+}
@@ -0,0 +1,181 @@
+#pragma once
+#include "Utils.h"
+
+namespace Elite
+{
+	//Counters of a LineOfSightCache, kept until they are reset
+	struct LineOfSightCacheStatistics
+	{
+		int nrOfHits = 0;
+		int nrOfMisses = 0;
+		int nrOfEvictions = 0; // valid entries replaced by another pair of cells
+		int nrOfInvalidations = 0; // entries dropped because a cell in their bounding box changed
+
+		float GetHitRate() const { return (nrOfHits + nrOfMisses > 0) ? float(nrOfHits) / float(nrOfHits + nrOfMisses) : 0.f; }
+	};
+
+	//Remembers the line of sight results between pairs of cells of a grid graph.
+	//The cache has a fixed number of entries, grouped in sets of Ways entries. A pair can only be stored in the set its cell indices hash to,
+	//when that set is full an entry is evicted with the clock algorithm: entries that were hit since the hand last passed them get a second chance.
+	//A line of sight only depends on the cells in the bounding box of its two cells, so when the graph changes only the entries
+	//whose bounding box contains a changed cell are dropped. The changed cells are read from the journal of the graph on the next query.
+	//A cache must only be used by one search at a time, it can be shared by pathfinders that search one after the other.
+	template<class T_NodeType, class T_ConnectionType>
+	class LineOfSightCache
+	{
+	public:
+		// capacity is rounded up to a power of two
+		explicit LineOfSightCache(const GridGraph<T_NodeType, T_ConnectionType>* pGraph, int capacity = 4096);
+
+		bool HasLineOfSight(T_NodeType* pStartNode, T_NodeType* pTargetNode);
+
+		void Clear();
+		int GetCapacity() const { return int(m_Entries.size()); }
+
+		const LineOfSightCacheStatistics& GetStatistics() const { return m_Statistics; }
+		void ResetStatistics() { m_Statistics = LineOfSightCacheStatistics{}; }
+
+	private:
+		enum { Ways = 4 };
+
+		struct Entry
+		{
+			int startIdx = invalid_node_index; // invalid_node_index marks an empty entry
+			int targetIdx = invalid_node_index;
+			bool hasLineOfSight = false;
+			bool isReferenced = false;
+		};
+
+		int GetSetIndex(int startIdx, int targetIdx) const;
+		// drops the entries invalidated by the changes made to the graph since the last query
+		void Synchronize();
+
+		const GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
+		vector<Entry> m_Entries; // the entries of set s are [s * Ways, s * Ways + Ways)
+		vector<uint8_t> m_ClockHands; // next entry to consider for eviction, per set
+		int m_SetMask;
+
+		unsigned int m_GraphVersion;
+		vector<int> m_ChangedCells; // reused by Synchronize
+
+		LineOfSightCacheStatistics m_Statistics;
+	};
+
+	template<class T_NodeType, class T_ConnectionType>
+	LineOfSightCache<T_NodeType, T_ConnectionType>::LineOfSightCache(const GridGraph<T_NodeType, T_ConnectionType>* pGraph, int capacity)
+		: m_pGraph(pGraph)
+		, m_GraphVersion(pGraph->GetVersion())
+	{
+		assert(capacity > 0 && "<LineOfSightCache>: capacity has to be positive");
+
+		int nrOfSets{ 1 };
+		while (nrOfSets * Ways < capacity)
+			nrOfSets *= 2;
+
+		m_Entries.resize(nrOfSets * Ways);
+		m_ClockHands.resize(nrOfSets, 0);
+		m_SetMask = nrOfSets - 1;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	bool LineOfSightCache<T_NodeType, T_ConnectionType>::HasLineOfSight(T_NodeType* pStartNode, T_NodeType* pTargetNode)
+	{
+		if (m_GraphVersion != m_pGraph->GetVersion())
+			Synchronize();
+
+		const int startIdx{ pStartNode->GetIndex() };
+		const int targetIdx{ pTargetNode->GetIndex() };
+		const int setIdx{ GetSetIndex(startIdx, targetIdx) };
+		Entry* pSet{ &m_Entries[setIdx * Ways] };
+
+		for (int way = 0; way < Ways; ++way)
+		{
+			if (pSet[way].startIdx == startIdx && pSet[way].targetIdx == targetIdx)
+			{
+				++m_Statistics.nrOfHits;
+				pSet[way].isReferenced = true;
+				return pSet[way].hasLineOfSight;
+			}
+		}
+
+		++m_Statistics.nrOfMisses;
+		const bool hasLineOfSight{ PathFindingUtils::HasLineOfSight(m_pGraph, pStartNode, pTargetNode) };
+
+		//Clock: skip (and age) referenced entries, an empty entry is never referenced so it is taken first time round
+		uint8_t& hand{ m_ClockHands[setIdx] };
+		while (pSet[hand].isReferenced)
+		{
+			pSet[hand].isReferenced = false;
+			hand = uint8_t((hand + 1) % Ways);
+		}
+
+		Entry& victim{ pSet[hand] };
+		hand = uint8_t((hand + 1) % Ways);
+		if (victim.startIdx != invalid_node_index)
+			++m_Statistics.nrOfEvictions;
+
+		victim = Entry{ startIdx, targetIdx, hasLineOfSight, false };
+		return hasLineOfSight;
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void LineOfSightCache<T_NodeType, T_ConnectionType>::Clear()
+	{
+		std::fill(m_Entries.begin(), m_Entries.end(), Entry{});
+		std::fill(m_ClockHands.begin(), m_ClockHands.end(), uint8_t(0));
+		m_GraphVersion = m_pGraph->GetVersion();
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	inline int LineOfSightCache<T_NodeType, T_ConnectionType>::GetSetIndex(int startIdx, int targetIdx) const
+	{
+		const uint32_t hash{ uint32_t(startIdx) * 0x9E3779B1u ^ uint32_t(targetIdx) * 0x85EBCA77u };
+		return int((hash ^ (hash >> 16)) & uint32_t(m_SetMask));
+	}
+
+	template<class T_NodeType, class T_ConnectionType>
+	void LineOfSightCache<T_NodeType, T_ConnectionType>::Synchronize()
+	{
+		m_ChangedCells.clear();
+		if (!m_pGraph->GetChangedCells(m_GraphVersion, m_ChangedCells))
+		{
+			//The journal no longer goes back to the last query, any entry could be outdated
+			for (const Entry& entry : m_Entries)
+			{
+				if (entry.startIdx != invalid_node_index)
+					++m_Statistics.nrOfInvalidations;
+			}
+			Clear();
+			return;
+		}
+		m_GraphVersion = m_pGraph->GetVersion();
+
+		const int nrOfColumns{ m_pGraph->GetColumns() };
+		for (Entry& entry : m_Entries)
+		{
+			if (entry.startIdx == invalid_node_index)
+				continue;
+
+			const int startCol{ entry.startIdx % nrOfColumns };
+			const int startRow{ entry.startIdx / nrOfColumns };
+			const int targetCol{ entry.targetIdx % nrOfColumns };
+			const int targetRow{ entry.targetIdx / nrOfColumns };
+			const int minCol{ (startCol < targetCol) ? startCol : targetCol };
+			const int maxCol{ (startCol < targetCol) ? targetCol : startCol };
+			const int minRow{ (startRow < targetRow) ? startRow : targetRow };
+			const int maxRow{ (startRow < targetRow) ? targetRow : startRow };
+
+			for (int changedIdx : m_ChangedCells)
+			{
+				const int col{ changedIdx % nrOfColumns };
+				const int row{ changedIdx / nrOfColumns };
+				if (col >= minCol && col <= maxCol && row >= minRow && row <= maxRow)
+				{
+					++m_Statistics.nrOfInvalidations;
+					entry = Entry{};
+					break;
+				}
+			}
+		}
+	}
+}
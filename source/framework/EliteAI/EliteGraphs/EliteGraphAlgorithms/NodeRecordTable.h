@@ -0,0 +1,65 @@
+#pragma once
+#include <vector>
+
+namespace Elite
+{
+	//Flat per-node search records, indexed by node index.
+	//Every search bumps the generation counter: slots stamped with an older generation count as not visited,
+	//so the table never has to be cleared or rehashed between searches.
+	template <class T_Record>
+	class NodeRecordTable
+	{
+	public:
+		//Starts a new search over a graph with nrOfNodes nodes
+		void Reset(int nrOfNodes);
+
+		bool Contains(int idx) const { return m_Slots[idx].generation == m_Generation; }
+		const T_Record& Get(int idx) const { return m_Slots[idx].record; }
+		//For searches that update their records in place
+		T_Record& Get(int idx) { return m_Slots[idx].record; }
+		void Add(int idx, const T_Record& record);
+
+		//Indices of all the records added since the last Reset, in insertion order
+		const std::vector<int>& GetVisitedIndices() const { return m_VisitedIndices; }
+		size_t Size() const { return m_VisitedIndices.size(); }
+
+	private:
+		struct Slot
+		{
+			unsigned int generation = 0;
+			T_Record record{};
+		};
+
+		std::vector<Slot> m_Slots;
+		std::vector<int> m_VisitedIndices;
+		unsigned int m_Generation = 0;
+	};
+
+	template <class T_Record>
+	void NodeRecordTable<T_Record>::Reset(int nrOfNodes)
+	{
+		if (int(m_Slots.size()) < nrOfNodes)
+			m_Slots.resize(nrOfNodes);
+
+		m_VisitedIndices.clear();
+
+		//On wrap around the old stamps could collide with the new generations, only then the stamps are cleared
+		if (++m_Generation == 0)
+		{
+			for (Slot& slot : m_Slots)
+				slot.generation = 0;
+
+			m_Generation = 1;
+		}
+	}
+
+	template <class T_Record>
+	void NodeRecordTable<T_Record>::Add(int idx, const T_Record& record)
+	{
+		assert(!Contains(idx) && "<NodeRecordTable::Add>: node already has a record in this search");
+
+		m_Slots[idx].generation = m_Generation;
+		m_Slots[idx].record = record;
+		m_VisitedIndices.push_back(idx);
+	}
+}
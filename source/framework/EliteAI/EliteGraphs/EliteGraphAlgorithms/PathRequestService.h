@@ -0,0 +1,371 @@
+#pragma once
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <queue>
+#include <unordered_map>
+#include "SearchContext.h"
+
+namespace Elite
+{
+	enum class PathRequestStatus
+	{
+		Unknown, // never issued, cancelled, superseded by a newer request of the same requester, or already taken
+		Pending,
+		Running,
+		Done,
+		Expired // the deadline passed before a worker could start it
+	};
+
+	//Counters of a PathRequestService, the latencies (request to result) are those of the requests finished since the previous TakeStatistics
+	struct PathRequestStatistics
+	{
+		int nrOfFinishedRequests = 0;
+		int nrOfExpiredRequests = 0;
+		int nrOfCancelledRequests = 0;
+		int nrOfSupersededRequests = 0; // dropped because the same requester asked for a new path
+		float latency50 = 0.f; // seconds
+		float latency95 = 0.f;
+		float latency99 = 0.f;
+		float maxLatency = 0.f;
+	};
+
+	//Finds paths on background threads, so game code never has to wait for a search.
+	//A request returns a ticket right away, the game polls it (GetStatus, TakePath) in a later frame.
+	//Pending requests run in order of priority (highest first), then deadline, then age. A request that has not started when its deadline passes expires.
+	//A requester (an agent) that asks for a new path because its start or destination moved supersedes its older request,
+	//which is dropped before it runs or has its result thrown away if it was already running.
+	//Every worker has its own search context and uses the const FindPath of the pathfinder, the same rules as for BatchPathfinder apply.
+	//The graph must not change while requests run: call Suspend before editing it and Resume afterwards.
+	//Resume (and the constructor) rebuild the compressed adjacency of the graph an edit left outdated before any worker searches again,
+	//so the workers never rebuild it at the same time. The pathfinder has to expose the graph it searches with GetGraph, every pathfinder with a Context does.
+	template <class T_NodeType, class T_Pathfinder>
+	class PathRequestService
+	{
+	public:
+		using Ticket = unsigned int;
+		enum : Ticket { invalid_ticket = 0 };
+
+		explicit PathRequestService(const T_Pathfinder* pPathfinder, int nrOfWorkers = 1);
+		~PathRequestService();
+
+		// timeout in seconds, negative for no deadline. A requester id of -1 never supersedes other requests
+		Ticket RequestPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, int priority = 0, float timeout = -1.f, int requesterId = -1);
+		// drops the request, a running search finishes but its result is thrown away
+		bool Cancel(Ticket ticket);
+
+		PathRequestStatus GetStatus(Ticket ticket) const;
+		// moves the path of a finished request into path and forgets the ticket, returns false if it isn't done
+		bool TakePath(Ticket ticket, std::vector<T_NodeType*>& path);
+		// forgets a finished or expired ticket without taking its path
+		void Release(Ticket ticket);
+
+		// stops starting requests and waits for the running ones, the graph can be edited until Resume
+		void Suspend();
+		void Resume();
+
+		// counters and latency percentiles since the previous call, meant to be called once per frame
+		PathRequestStatistics TakeStatistics();
+
+	private:
+		using Clock = std::chrono::steady_clock;
+
+		struct Request
+		{
+			T_NodeType* pStartNode = nullptr;
+			T_NodeType* pDestinationNode = nullptr;
+			int requesterId = -1;
+			Clock::time_point requestTime;
+			Clock::time_point deadline;
+			PathRequestStatus status = PathRequestStatus::Pending; // stays Pending after the deadline until a worker or Release sees it
+			std::vector<T_NodeType*> path;
+		};
+
+		// entry of the queue of pending requests, cancelled and superseded requests are skipped when they come up
+		struct QueueEntry
+		{
+			int priority;
+			Clock::time_point deadline;
+			Ticket ticket;
+
+			// std::priority_queue puts the greatest entry on top
+			bool operator<(const QueueEntry& other) const
+			{
+				if (priority != other.priority)
+					return priority < other.priority;
+				if (deadline != other.deadline)
+					return deadline > other.deadline;
+				return ticket > other.ticket;
+			}
+		};
+
+		void WorkerLoop(int workerIdx);
+		// status of the request as the game sees it, a pending request is expired as soon as its deadline passes
+		PathRequestStatus GetCurrentStatus(const Request& request) const;
+		// forgets a request that hasn't finished yet, running searches see it is gone when they finish
+		void DropRequest(typename std::unordered_map<Ticket, Request>::iterator it);
+
+		const T_Pathfinder* m_pPathfinder;
+		std::vector<typename T_Pathfinder::Context> m_Contexts; // one per worker
+		std::vector<std::thread> m_Workers;
+
+		mutable std::mutex m_Mutex;
+		std::condition_variable m_RequestAdded;
+		std::condition_variable m_WorkerIdle;
+		std::priority_queue<QueueEntry> m_Queue;
+		std::unordered_map<Ticket, Request> m_Requests;
+		std::unordered_map<int, Ticket> m_LatestTickets; // requester id -> its latest request
+		Ticket m_NextTicket = 1;
+		int m_NrOfRunningRequests = 0;
+		bool m_IsSuspended = false;
+		bool m_IsShuttingDown = false;
+
+		PathRequestStatistics m_Statistics;
+		std::vector<float> m_Latencies;
+
+		PathRequestService(const PathRequestService&) = delete;
+		PathRequestService& operator=(const PathRequestService&) = delete;
+	};
+
+	template <class T_NodeType, class T_Pathfinder>
+	PathRequestService<T_NodeType, T_Pathfinder>::PathRequestService(const T_Pathfinder* pPathfinder, int nrOfWorkers)
+		: m_pPathfinder(pPathfinder)
+	{
+		assert(nrOfWorkers > 0 && "<PathRequestService>: needs at least one worker");
+
+		m_pPathfinder->GetGraph()->EnsureCompactConnections();
+
+		m_Contexts.resize(nrOfWorkers);
+		m_Workers.reserve(nrOfWorkers);
+		for (int workerIdx{ 0 }; workerIdx < nrOfWorkers; ++workerIdx)
+			m_Workers.emplace_back(&PathRequestService::WorkerLoop, this, workerIdx);
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	PathRequestService<T_NodeType, T_Pathfinder>::~PathRequestService()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_IsShuttingDown = true;
+		}
+		m_RequestAdded.notify_all();
+
+		for (std::thread& worker : m_Workers)
+			worker.join();
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	typename PathRequestService<T_NodeType, T_Pathfinder>::Ticket PathRequestService<T_NodeType, T_Pathfinder>::RequestPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, int priority, float timeout, int requesterId)
+	{
+		const Clock::time_point requestTime{ Clock::now() };
+		const Clock::time_point deadline{ (timeout < 0.f) ? Clock::time_point::max()
+			: requestTime + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<float>(timeout)) };
+
+		Ticket ticket{};
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			ticket = m_NextTicket++;
+			if (m_NextTicket == invalid_ticket)
+				++m_NextTicket;
+
+			//The start or destination of the requester moved, its older path is of no use anymore
+			if (requesterId != -1)
+			{
+				auto latestIt = m_LatestTickets.find(requesterId);
+				if (latestIt != m_LatestTickets.end())
+				{
+					auto it = m_Requests.find(latestIt->second);
+					const PathRequestStatus status{ (it != m_Requests.end()) ? GetCurrentStatus(it->second) : PathRequestStatus::Unknown };
+					if (status == PathRequestStatus::Pending || status == PathRequestStatus::Running)
+					{
+						DropRequest(it);
+						++m_Statistics.nrOfSupersededRequests;
+					}
+				}
+				m_LatestTickets[requesterId] = ticket;
+			}
+
+			Request& request{ m_Requests[ticket] };
+			request.pStartNode = pStartNode;
+			request.pDestinationNode = pDestinationNode;
+			request.requesterId = requesterId;
+			request.requestTime = requestTime;
+			request.deadline = deadline;
+			m_Queue.push(QueueEntry{ priority, deadline, ticket });
+		}
+		m_RequestAdded.notify_one();
+
+		return ticket;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	bool PathRequestService<T_NodeType, T_Pathfinder>::Cancel(Ticket ticket)
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Requests.find(ticket);
+		const PathRequestStatus status{ (it != m_Requests.end()) ? GetCurrentStatus(it->second) : PathRequestStatus::Unknown };
+		if (status != PathRequestStatus::Pending && status != PathRequestStatus::Running)
+			return false;
+
+		DropRequest(it);
+		++m_Statistics.nrOfCancelledRequests;
+		return true;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	PathRequestStatus PathRequestService<T_NodeType, T_Pathfinder>::GetStatus(Ticket ticket) const
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Requests.find(ticket);
+		return (it != m_Requests.end()) ? GetCurrentStatus(it->second) : PathRequestStatus::Unknown;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	bool PathRequestService<T_NodeType, T_Pathfinder>::TakePath(Ticket ticket, std::vector<T_NodeType*>& path)
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Requests.find(ticket);
+		if (it == m_Requests.end() || it->second.status != PathRequestStatus::Done)
+			return false;
+
+		path = std::move(it->second.path);
+		DropRequest(it);
+		return true;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void PathRequestService<T_NodeType, T_Pathfinder>::Release(Ticket ticket)
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		auto it = m_Requests.find(ticket);
+		if (it == m_Requests.end())
+			return;
+
+		const PathRequestStatus status{ GetCurrentStatus(it->second) };
+		if (status != PathRequestStatus::Done && status != PathRequestStatus::Expired)
+			return;
+
+		//No worker took the expired request from the queue yet, so it isn't counted yet
+		if (it->second.status == PathRequestStatus::Pending)
+			++m_Statistics.nrOfExpiredRequests;
+		DropRequest(it);
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void PathRequestService<T_NodeType, T_Pathfinder>::Suspend()
+	{
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		m_IsSuspended = true;
+		m_WorkerIdle.wait(lock, [this]() { return m_NrOfRunningRequests == 0; });
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void PathRequestService<T_NodeType, T_Pathfinder>::Resume()
+	{
+		{
+			std::lock_guard<std::mutex> lock{ m_Mutex };
+			m_pPathfinder->GetGraph()->EnsureCompactConnections();
+			m_IsSuspended = false;
+		}
+		m_RequestAdded.notify_all();
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	PathRequestStatistics PathRequestService<T_NodeType, T_Pathfinder>::TakeStatistics()
+	{
+		std::lock_guard<std::mutex> lock{ m_Mutex };
+		PathRequestStatistics statistics{ m_Statistics };
+		m_Statistics = PathRequestStatistics{};
+
+		//Percentiles by partial sorting, the index of percentile p is p * (n - 1) rounded down
+		auto getPercentile = [this](float percentile)
+		{
+			auto nthIt = m_Latencies.begin() + size_t(percentile * float(m_Latencies.size() - 1));
+			std::nth_element(m_Latencies.begin(), nthIt, m_Latencies.end());
+			return *nthIt;
+		};
+
+		if (!m_Latencies.empty())
+		{
+			statistics.latency50 = getPercentile(0.5f);
+			statistics.latency95 = getPercentile(0.95f);
+			statistics.latency99 = getPercentile(0.99f);
+			statistics.maxLatency = *std::max_element(m_Latencies.cbegin(), m_Latencies.cend());
+		}
+		m_Latencies.clear();
+
+		return statistics;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	PathRequestStatus PathRequestService<T_NodeType, T_Pathfinder>::GetCurrentStatus(const Request& request) const
+	{
+		if (request.status == PathRequestStatus::Pending && Clock::now() > request.deadline)
+			return PathRequestStatus::Expired;
+		return request.status;
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void PathRequestService<T_NodeType, T_Pathfinder>::DropRequest(typename std::unordered_map<Ticket, Request>::iterator it)
+	{
+		auto latestIt = m_LatestTickets.find(it->second.requesterId);
+		if (latestIt != m_LatestTickets.end() && latestIt->second == it->first)
+			m_LatestTickets.erase(latestIt);
+
+		m_Requests.erase(it);
+	}
+
+	template <class T_NodeType, class T_Pathfinder>
+	void PathRequestService<T_NodeType, T_Pathfinder>::WorkerLoop(int workerIdx)
+	{
+		auto& context{ m_Contexts[workerIdx] };
+		std::vector<T_NodeType*> path{};
+
+		std::unique_lock<std::mutex> lock{ m_Mutex };
+		while (true)
+		{
+			m_RequestAdded.wait(lock, [this]() { return m_IsShuttingDown || (!m_IsSuspended && !m_Queue.empty()); });
+			if (m_IsShuttingDown)
+				return;
+
+			const QueueEntry entry{ m_Queue.top() };
+			m_Queue.pop();
+
+			//Cancelled and superseded requests are already gone
+			auto it = m_Requests.find(entry.ticket);
+			if (it == m_Requests.end() || it->second.status != PathRequestStatus::Pending)
+				continue;
+
+			if (GetCurrentStatus(it->second) == PathRequestStatus::Expired)
+			{
+				it->second.status = PathRequestStatus::Expired;
+				++m_Statistics.nrOfExpiredRequests;
+				continue;
+			}
+
+			it->second.status = PathRequestStatus::Running;
+			T_NodeType* pStartNode{ it->second.pStartNode };
+			T_NodeType* pDestinationNode{ it->second.pDestinationNode };
+			++m_NrOfRunningRequests;
+
+			lock.unlock();
+			m_pPathfinder->FindPath(pStartNode, pDestinationNode, path, context);
+			lock.lock();
+
+			--m_NrOfRunningRequests;
+			if (m_NrOfRunningRequests == 0)
+				m_WorkerIdle.notify_all();
+
+			//The request can have been cancelled or superseded while it ran (the ticket is gone then)
+			it = m_Requests.find(entry.ticket);
+			if (it == m_Requests.end())
+				continue;
+
+			it->second.status = PathRequestStatus::Done;
+			it->second.path.swap(path);
+			m_Latencies.push_back(std::chrono::duration<float>(Clock::now() - it->second.requestTime).count());
+			++m_Statistics.nrOfFinishedRequests;
+		}
+	}
+}
@@ -0,0 +1,409 @@
+#pragma once
+#include <vector>
+
+namespace Elite
+{
+	//Indexed priority queues used as open list by the pathfinders.
+	//Every element is stored under a handle (the node index), which allows looking up an open record in O(1)
+	//and lowering its priority in O(log n) instead of scanning the whole open list.
+	//The element with the lowest value (T_Element::operator<) is on top.
+	//Usage: Reserve(nrOfNodes) once, then Push/DecreaseKey/Pop with handles in [0, nrOfNodes[
+	//Update and Remove are for searches that also raise or drop open elements (D* Lite), A* only ever lowers them.
+	template <class T_Element, int Arity>
+	class DAryHeap
+	{
+	public:
+		void Reserve(int nrOfHandles);
+		void Clear();
+
+		bool Empty() const { return m_Heap.empty(); }
+		size_t Size() const { return m_Heap.size(); }
+		bool Contains(int handle) const { return m_Positions[handle] != invalid_position; }
+
+		const T_Element& Get(int handle) const { return m_Heap[m_Positions[handle]].element; }
+		const T_Element& Top() const { return m_Heap.front().element; }
+
+		void Push(int handle, const T_Element& element);
+		// element must not be greater than the one currently stored under handle
+		void DecreaseKey(int handle, const T_Element& element);
+		// element can be greater or smaller than the one currently stored under handle
+		void Update(int handle, const T_Element& element);
+		void Remove(int handle);
+		T_Element Pop();
+
+	private:
+		enum { invalid_position = -1 };
+
+		struct HeapEntry
+		{
+			int handle;
+			T_Element element;
+		};
+
+		std::vector<HeapEntry> m_Heap;
+		std::vector<int> m_Positions; // handle -> position in m_Heap
+
+		void SiftUp(int pos);
+		void SiftDown(int pos);
+		void Place(int pos, HeapEntry&& entry);
+	};
+
+	template <class T_Element>
+	using BinaryHeap = DAryHeap<T_Element, 2>;
+
+	template <class T_Element>
+	using QuaternaryHeap = DAryHeap<T_Element, 4>;
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Reserve(int nrOfHandles)
+	{
+		if (int(m_Positions.size()) < nrOfHandles)
+			m_Positions.resize(nrOfHandles, invalid_position);
+
+		m_Heap.reserve(nrOfHandles);
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Clear()
+	{
+		//Only the handles still in the heap have a valid position, no need to touch the whole handle map
+		for (const HeapEntry& entry : m_Heap)
+			m_Positions[entry.handle] = invalid_position;
+
+		m_Heap.clear();
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Push(int handle, const T_Element& element)
+	{
+		assert(!Contains(handle) && "<DAryHeap::Push>: handle is already in the heap");
+
+		m_Heap.push_back(HeapEntry{ handle, element });
+		m_Positions[handle] = int(m_Heap.size()) - 1;
+		SiftUp(int(m_Heap.size()) - 1);
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::DecreaseKey(int handle, const T_Element& element)
+	{
+		assert(Contains(handle) && "<DAryHeap::DecreaseKey>: handle is not in the heap");
+
+		int pos{ m_Positions[handle] };
+		m_Heap[pos].element = element;
+		SiftUp(pos);
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Update(int handle, const T_Element& element)
+	{
+		assert(Contains(handle) && "<DAryHeap::Update>: handle is not in the heap");
+
+		//At most one of both moves the element
+		int pos{ m_Positions[handle] };
+		m_Heap[pos].element = element;
+		SiftUp(pos);
+		SiftDown(m_Positions[handle]);
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Remove(int handle)
+	{
+		assert(Contains(handle) && "<DAryHeap::Remove>: handle is not in the heap");
+
+		//The last element takes the free place, it can belong higher or lower than that
+		int pos{ m_Positions[handle] };
+		m_Positions[handle] = invalid_position;
+		if (pos == int(m_Heap.size()) - 1)
+		{
+			m_Heap.pop_back();
+			return;
+		}
+
+		Place(pos, std::move(m_Heap.back()));
+		m_Heap.pop_back();
+		SiftUp(pos);
+		SiftDown(pos); // does nothing if it moved up, the element that took its place already fits there
+	}
+
+	template <class T_Element, int Arity>
+	T_Element DAryHeap<T_Element, Arity>::Pop()
+	{
+		assert(!m_Heap.empty() && "<DAryHeap::Pop>: heap is empty");
+
+		T_Element top{ std::move(m_Heap.front().element) };
+		m_Positions[m_Heap.front().handle] = invalid_position;
+
+		if (m_Heap.size() > 1)
+		{
+			Place(0, std::move(m_Heap.back()));
+			m_Heap.pop_back();
+			SiftDown(0);
+		}
+		else
+			m_Heap.pop_back();
+
+		return top;
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::SiftUp(int pos)
+	{
+		HeapEntry entry{ std::move(m_Heap[pos]) };
+		while (pos > 0)
+		{
+			int parent{ (pos - 1) / Arity };
+			if (!(entry.element < m_Heap[parent].element))
+				break;
+
+			Place(pos, std::move(m_Heap[parent]));
+			pos = parent;
+		}
+
+		Place(pos, std::move(entry));
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::SiftDown(int pos)
+	{
+		const int size{ int(m_Heap.size()) };
+		HeapEntry entry{ std::move(m_Heap[pos]) };
+		while (true)
+		{
+			int firstChild{ pos * Arity + 1 };
+			if (firstChild >= size)
+				break;
+
+			int lastChild{ (firstChild + Arity < size) ? firstChild + Arity : size };
+			int minChild{ firstChild };
+			for (int child{ firstChild + 1 }; child < lastChild; ++child)
+			{
+				if (m_Heap[child].element < m_Heap[minChild].element)
+					minChild = child;
+			}
+
+			if (!(m_Heap[minChild].element < entry.element))
+				break;
+
+			Place(pos, std::move(m_Heap[minChild]));
+			pos = minChild;
+		}
+
+		Place(pos, std::move(entry));
+	}
+
+	template <class T_Element, int Arity>
+	void DAryHeap<T_Element, Arity>::Place(int pos, HeapEntry&& entry)
+	{
+		m_Positions[entry.handle] = pos;
+		m_Heap[pos] = std::move(entry);
+	}
+
+	//Pairing heap: O(1) push and decrease key, amortized O(log n) pop.
+	//The tree nodes live in a flat vector indexed by handle, so no allocations happen once reserved.
+	template <class T_Element>
+	class PairingHeap
+	{
+	public:
+		void Reserve(int nrOfHandles);
+		void Clear();
+
+		bool Empty() const { return m_Root == invalid_handle; }
+		size_t Size() const { return m_Size; }
+		bool Contains(int handle) const { return m_Nodes[handle].generation == m_Generation; }
+
+		const T_Element& Get(int handle) const { return m_Nodes[handle].element; }
+		const T_Element& Top() const { return m_Nodes[m_Root].element; }
+
+		void Push(int handle, const T_Element& element);
+		// element must not be greater than the one currently stored under handle
+		void DecreaseKey(int handle, const T_Element& element);
+		// element can be greater or smaller than the one currently stored under handle
+		void Update(int handle, const T_Element& element);
+		void Remove(int handle);
+		T_Element Pop();
+
+	private:
+		enum { invalid_handle = -1 };
+
+		struct HeapNode
+		{
+			T_Element element{};
+			int child = invalid_handle;
+			int next = invalid_handle; // right sibling
+			int prev = invalid_handle; // left sibling, or parent for the leftmost child
+			unsigned int generation = 0; // equals m_Generation while the node is in the heap
+		};
+
+		std::vector<HeapNode> m_Nodes;
+		std::vector<int> m_MergeBuffer;
+		int m_Root = invalid_handle;
+		size_t m_Size = 0;
+		unsigned int m_Generation = 1;
+
+		int Link(int first, int second);
+		// detaches the subtree of a node that isn't the root from its parent
+		void Cut(int handle);
+		// detaches the children of a node and merges them into one tree, returns its root
+		int MergeChildren(int handle);
+	};
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Reserve(int nrOfHandles)
+	{
+		if (int(m_Nodes.size()) < nrOfHandles)
+			m_Nodes.resize(nrOfHandles);
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Clear()
+	{
+		//Bumping the generation invalidates every node at once
+		++m_Generation;
+		m_Root = invalid_handle;
+		m_Size = 0;
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Push(int handle, const T_Element& element)
+	{
+		assert(!Contains(handle) && "<PairingHeap::Push>: handle is already in the heap");
+
+		HeapNode& node{ m_Nodes[handle] };
+		node.element = element;
+		node.child = node.next = node.prev = invalid_handle;
+		node.generation = m_Generation;
+
+		m_Root = (m_Root == invalid_handle) ? handle : Link(m_Root, handle);
+		++m_Size;
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::DecreaseKey(int handle, const T_Element& element)
+	{
+		assert(Contains(handle) && "<PairingHeap::DecreaseKey>: handle is not in the heap");
+
+		m_Nodes[handle].element = element;
+		if (handle == m_Root)
+			return;
+
+		//Cut the subtree from its parent and merge it back with the root
+		Cut(handle);
+		m_Root = Link(m_Root, handle);
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Update(int handle, const T_Element& element)
+	{
+		assert(Contains(handle) && "<PairingHeap::Update>: handle is not in the heap");
+
+		if (!(m_Nodes[handle].element < element))
+		{
+			DecreaseKey(handle, element);
+			return;
+		}
+
+		//A greater element could be smaller than some of its children, insert it again
+		Remove(handle);
+		Push(handle, element);
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Remove(int handle)
+	{
+		assert(Contains(handle) && "<PairingHeap::Remove>: handle is not in the heap");
+
+		if (handle == m_Root)
+		{
+			Pop();
+			return;
+		}
+
+		//The children of the node take its place as one tree merged with the root
+		Cut(handle);
+		m_Nodes[handle].generation = m_Generation - 1;
+		--m_Size;
+
+		int subtree{ MergeChildren(handle) };
+		if (subtree != invalid_handle)
+			m_Root = Link(m_Root, subtree);
+	}
+
+	template <class T_Element>
+	T_Element PairingHeap<T_Element>::Pop()
+	{
+		assert(!Empty() && "<PairingHeap::Pop>: heap is empty");
+
+		HeapNode& rootNode{ m_Nodes[m_Root] };
+		T_Element top{ std::move(rootNode.element) };
+		rootNode.generation = m_Generation - 1;
+		--m_Size;
+
+		m_Root = MergeChildren(m_Root);
+
+		return top;
+	}
+
+	template <class T_Element>
+	void PairingHeap<T_Element>::Cut(int handle)
+	{
+		HeapNode& node{ m_Nodes[handle] };
+		if (m_Nodes[node.prev].child == handle)
+			m_Nodes[node.prev].child = node.next;
+		else
+			m_Nodes[node.prev].next = node.next;
+
+		if (node.next != invalid_handle)
+			m_Nodes[node.next].prev = node.prev;
+
+		node.next = node.prev = invalid_handle;
+	}
+
+	template <class T_Element>
+	int PairingHeap<T_Element>::MergeChildren(int handle)
+	{
+		//Detach all children of the node
+		m_MergeBuffer.clear();
+		for (int child{ m_Nodes[handle].child }; child != invalid_handle;)
+		{
+			int next{ m_Nodes[child].next };
+			m_Nodes[child].next = m_Nodes[child].prev = invalid_handle;
+			m_MergeBuffer.push_back(child);
+			child = next;
+		}
+		m_Nodes[handle].child = invalid_handle;
+
+		//Two pass pairing: merge pairs left to right, then fold the results right to left
+		size_t nrOfSubtrees{ m_MergeBuffer.size() };
+		size_t nrOfPairs{ 0 };
+		for (size_t idx{ 0 }; idx + 1 < nrOfSubtrees; idx += 2)
+			m_MergeBuffer[nrOfPairs++] = Link(m_MergeBuffer[idx], m_MergeBuffer[idx + 1]);
+
+		if (nrOfSubtrees % 2 == 1)
+			m_MergeBuffer[nrOfPairs++] = m_MergeBuffer[nrOfSubtrees - 1];
+
+		int root{ invalid_handle };
+		for (size_t idx{ nrOfPairs }; idx > 0; --idx)
+			root = (root == invalid_handle) ? m_MergeBuffer[idx - 1] : Link(m_MergeBuffer[idx - 1], root);
+
+		return root;
+	}
+
+	template <class T_Element>
+	int PairingHeap<T_Element>::Link(int first, int second)
+	{
+		//Both nodes are roots of detached trees, the greater one becomes the leftmost child of the other
+		if (m_Nodes[second].element < m_Nodes[first].element)
+			std::swap(first, second);
+
+		HeapNode& parent{ m_Nodes[first] };
+		HeapNode& child{ m_Nodes[second] };
+		child.next = parent.child;
+		if (parent.child != invalid_handle)
+			m_Nodes[parent.child].prev = second;
+
+		child.prev = first;
+		parent.child = second;
+
+		return first;
+	}
+}
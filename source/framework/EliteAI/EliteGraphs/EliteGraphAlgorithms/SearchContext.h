@@ -0,0 +1,66 @@
+#pragma once
+#include "../EGraphEnums.h"
+#include "PriorityQueues.h"
+#include "NodeRecordTable.h"
+
+namespace Elite
+{
+	//Counters filled in by a search, reset when the search starts
+	struct SearchStatistics
+	{
+		int nrOfExpandedNodes = 0;
+		int nrOfLineOfSightChecks = 0;
+	};
+
+	//State of a time sliced search after a step
+	enum class SearchStatus
+	{
+		InProgress,
+		Found,
+		Failed // the destination can't be reached, the path leads to the closest node instead
+	};
+
+	//Scratch buffers of a search: the open list and the closed records.
+	//A context can be reused for any number of queries on the same graph, once its buffers have grown to the
+	//size of the graph a search doesn't allocate anymore.
+	//A context must only be used by one search at a time, use one context per thread to search in parallel.
+	template <class T_Record, template<class> class T_OpenList>
+	struct SearchContext
+	{
+		T_OpenList<T_Record> openList;
+		NodeRecordTable<T_Record> closedList;
+		SearchStatistics statistics;
+
+		// the query of the search, kept between the steps of a time sliced search
+		int startIdx = invalid_node_index;
+		int destinationIdx = invalid_node_index; // the closest reachable cell when the destination itself can't be reached
+		int destinationCol = 0; // of destinationIdx, so the heuristic doesn't compute them for every node
+		int destinationRow = 0;
+		bool isDestinationReachable = true;
+		SearchStatus status = SearchStatus::Failed;
+		// the expanded node with the lowest heuristic cost, where the path goes when the destination isn't reached
+		int closestIdx = invalid_node_index;
+		float closestHeuristicCost = FLT_MAX;
+
+		//Prepares the buffers for a new search over a graph with nrOfNodes nodes
+		void Reset(int nrOfNodes)
+		{
+			openList.Clear();
+			openList.Reserve(nrOfNodes);
+			closedList.Reset(nrOfNodes);
+			statistics = SearchStatistics{};
+			closestIdx = invalid_node_index;
+			closestHeuristicCost = FLT_MAX;
+		}
+
+		//Called for every expanded node, so a search that ends without reaching the destination doesn't have to look through the closed list
+		void UpdateClosestNode(int nodeIdx, float heuristicCost)
+		{
+			if (heuristicCost < closestHeuristicCost)
+			{
+				closestHeuristicCost = heuristicCost;
+				closestIdx = nodeIdx;
+			}
+		}
+	};
+}
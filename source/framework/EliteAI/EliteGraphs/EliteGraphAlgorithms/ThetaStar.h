@@ -1,10 +1,15 @@
 #pragma once
 #include <set>
-#include "Utils.h"
+#include "SearchContext.h"
+#include "HeuristicPolicies.h"
+#include "LineOfSightCache.h"
+#include "LandmarkHeuristic.h"
 
 namespace Elite
 {
-	template <class T_NodeType, class T_ConnectionType>
+	//T_OpenList: indexed priority queue policy used for the open list (BinaryHeap, QuaternaryHeap or PairingHeap)
+	//T_Heuristic: heuristic policy (see HeuristicPolicies.h), a distance policy inlines the heuristic, RuntimeHeuristic calls the Heuristic it is made with
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList = BinaryHeap, class T_Heuristic = RuntimeHeuristic>
 	class ThetaStar
 	{
 	public:
@@ -13,15 +18,15 @@ namespace Elite
 		// stores the optimal connection to a node and its total costs related to the start and end node of the path
 		struct NodeRecord
 		{
-			T_NodeType* pNode = nullptr;
-			T_NodeType* pParent = nullptr;
+			int nodeIdx = invalid_node_index;
+			int parentIdx = invalid_node_index;
 			float costSoFar = 0.f; // accumulated g-costs of all the connections leading up to this one
 			float estimatedTotalCost = 0.f; // f-cost (= costSoFar + h-cost)
 
 			bool operator==(const NodeRecord& other) const
 			{
-				return pNode == other.pNode
-					&& pParent == other.pParent
+				return nodeIdx == other.nodeIdx
+					&& parentIdx == other.parentIdx
 					&& costSoFar == other.costSoFar
 					&& estimatedTotalCost == other.estimatedTotalCost;
 			};
@@ -32,136 +37,235 @@ namespace Elite
 			};
 		};
 
-		using VisitedUMap = std::unordered_map<T_NodeType*, NodeRecord, size_t(*)(T_NodeType*)>;
+		using Context = SearchContext<NodeRecord, T_OpenList>;
 
 		std::vector<T_NodeType*> FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode);
+		// writes the path in a caller provided buffer, no allocations happen once path and the internal context have grown large enough
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path);
+		// searches with an external context, the pathfinder itself isn't modified
+		void FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const;
+
+		// time sliced search, see AStar::BeginSearch
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode, Context& context) const;
+		SearchStatus Step(int maxExpansions, Context& context) const;
+		SearchStatus StepFor(int maxMicroseconds, Context& context) const;
+		void GetPath(std::vector<T_NodeType*>& path, const Context& context) const;
+
+		void BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode) { BeginSearch(pStartNode, pDestinationNode, m_Context); }
+		SearchStatus Step(int maxExpansions) { return Step(maxExpansions, m_Context); }
+		SearchStatus StepFor(int maxMicroseconds) { return StepFor(maxMicroseconds, m_Context); }
+		void GetPath(std::vector<T_NodeType*>& path) const { GetPath(path, m_Context); }
+
+		// counters of the last search that ran on the internal context
+		const SearchStatistics& GetStatistics() const { return m_Context.statistics; }
+
+		// the graph that is searched, BatchPathfinder and PathRequestService prepare it before their threads search it
+		const GridGraph<T_NodeType, T_ConnectionType>* GetGraph() const { return m_pGraph; }
+
+		// optional, line of sight checks go through the cache when set (nullptr checks every line again)
+		// the cache is modified by the searches, so searches running in parallel can't share one
+		void SetLineOfSightCache(LineOfSightCache<T_NodeType, T_ConnectionType>* pCache) { m_pLineOfSightCache = pCache; }
+		// optional, see AStar::SetLandmarkHeuristic
+		// the landmark distances follow the grid connections, any-angle paths can be shorter so the estimates aren't admissible here
+		void SetLandmarkHeuristic(const LandmarkHeuristic<T_NodeType, T_ConnectionType>* pLandmarks) { m_pLandmarkHeuristic = pLandmarks; }
+
+		// optional bounds for searches that would take too long, 0 turns them off
+		// a search that runs into them ends as Failed, with the path to the closest node to the destination it expanded
+		void SetMaxNrOfExpansions(int maxNrOfExpansions) { m_MaxNrOfExpansions = maxNrOfExpansions; }
+		// nodes further than the radius (in cells) from the start are never opened
+		void SetSearchRadius(float searchRadius) { m_SearchRadius = searchRadius; }
 
 	private:
-		float GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const;
-		NodeRecord GetClosestToDestination(T_NodeType* pStartNode, T_NodeType* pDestinationNode, const VisitedUMap& visited) const;
-		void UpdateNode(T_NodeType* pParent, NodeRecord& neighborNodeRecord, const VisitedUMap& visited);
+		enum { ClockCheckInterval = 16 };
+
+		template <class T_Function>
+		SearchStatus Expand(Context& context, T_Function&& isOutOfBudget) const;
+		float GetHeuristicCost(int nodeIdx, const Context& context) const;
+		bool IsWithinSearchRadius(int idx, int startIdx) const;
+		void UpdateNode(int parentIdx, NodeRecord& neighborNodeRecord, Context& context) const;
 		//bool HasLineOfSight(T_NodeType* pStartNode, T_NodeType* pTargetNode) const;
 
 		GridGraph<T_NodeType, T_ConnectionType>* m_pGraph;
-		Heuristic m_HeuristicFunction;
+		T_Heuristic m_Heuristic;
+		LineOfSightCache<T_NodeType, T_ConnectionType>* m_pLineOfSightCache = nullptr;
+		const LandmarkHeuristic<T_NodeType, T_ConnectionType>* m_pLandmarkHeuristic = nullptr;
+		int m_MaxNrOfExpansions = 0;
+		float m_SearchRadius = 0.f;
+
+		// reused by every search started without an external context
+		Context m_Context;
 	};
 
-	template <class T_NodeType, class T_ConnectionType>
-	ThetaStar<T_NodeType, T_ConnectionType>::ThetaStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::ThetaStar(GridGraph<T_NodeType, T_ConnectionType>* pGraph, Heuristic hFunction)
 		: m_pGraph(pGraph)
-		, m_HeuristicFunction(hFunction)
+		, m_Heuristic(hFunction)
 	{
 	}
 
-	template <class T_NodeType, class T_ConnectionType>
-	std::vector<T_NodeType*> ThetaStar<T_NodeType, T_ConnectionType>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	std::vector<T_NodeType*> ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode)
 	{
-		//Same algorithm structures as A*
-		//expect for the UpdateNode step
-		std::vector<NodeRecord> openList;
-		NodeRecord currentNodeRecord;
-
-		auto hash = [](T_NodeType* node) { return std::hash<int>()(node->GetIndex()); };
-		VisitedUMap closedList{ unsigned int(m_pGraph->GetNrOfNodes()), hash };
 		vector<T_NodeType*> path{};
-		bool pathFound = false;
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
 
-		openList.push_back(NodeRecord{ pStartNode, nullptr, 0.f, GetHeuristicCost(pStartNode, pDestinationNode) });
-		while (!openList.empty() && !pathFound)
-		{
-			//use partial sort with reverse operator to get the min_element at the back of the vector
-			std::partial_sort(openList.rbegin(), openList.rbegin() + 1, openList.rend());
-			currentNodeRecord = std::move(openList.back());
-			openList.pop_back();
-			closedList.emplace(currentNodeRecord.pNode, currentNodeRecord);
+		return path;
+	}
 
-			if (currentNodeRecord.pNode != pDestinationNode)
-			{
-				auto connections{ m_pGraph->GetNodeConnections(currentNodeRecord.pNode->GetIndex()) };
-				for (T_ConnectionType* conn : connections)
-				{
-					T_NodeType* nextNode{ m_pGraph->GetNode(conn->GetTo()) };
-					float costSoFar{ currentNodeRecord.costSoFar + conn->GetCost() };
-					if (closedList.find(nextNode) == closedList.end())
-					{
-						NodeRecord nr{ nextNode, currentNodeRecord.pNode, costSoFar, 0.f };
-						UpdateNode(currentNodeRecord.pParent, nr, closedList);
-						nr.estimatedTotalCost = nr.costSoFar + GetHeuristicCost(nextNode, pDestinationNode);
-
-						auto existingOpenRecord{ std::find_if(openList.begin(), openList.end(), [nextNode](const NodeRecord& nr) { return nr.pNode == nextNode; }) };
-						if (existingOpenRecord == openList.end())
-						{
-							openList.push_back(nr);
-						}
-						else if (existingOpenRecord->costSoFar > nr.costSoFar)
-						{
-							(*existingOpenRecord) = nr;
-						}
-					}
-				}
-			}
-			else
-				pathFound = true;
-		}
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path)
+	{
+		FindPath(pStartNode, pDestinationNode, path, m_Context);
+	}
 
-		//If the path isn't find (inaccessible), look for the closest node from the end node
-		currentNodeRecord = pathFound ? currentNodeRecord : GetClosestToDestination(pStartNode, pDestinationNode, closedList);
-		while (currentNodeRecord.pNode != pStartNode)
-		{
-			path.push_back(currentNodeRecord.pNode);
-			currentNodeRecord = closedList[currentNodeRecord.pParent];
-		}
-		path.push_back(pStartNode);
-		std::reverse(path.begin(), path.end());
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::FindPath(T_NodeType* pStartNode, T_NodeType* pDestinationNode, std::vector<T_NodeType*>& path, Context& context) const
+	{
+		BeginSearch(pStartNode, pDestinationNode, context);
+		Expand(context, [](int) { return false; });
+		GetPath(path, context);
+	}
 
-		return path;
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::BeginSearch(T_NodeType* pStartNode, T_NodeType* pDestinationNode, Context& context) const
+	{
+		context.Reset(m_pGraph->GetNrOfNodes());
+		context.startIdx = pStartNode->GetIndex();
+		context.status = SearchStatus::InProgress;
+
+		//The component labels tell right away if the destination can't be reached, the search runs to the closest cell it can reach then
+		context.isDestinationReachable = pStartNode == pDestinationNode || m_pGraph->AreConnected(context.startIdx, pDestinationNode->GetIndex());
+		context.destinationIdx = context.isDestinationReachable ? pDestinationNode->GetIndex() : m_pGraph->GetClosestConnectedCell(context.startIdx, pDestinationNode->GetIndex());
+		context.destinationCol = context.destinationIdx % m_pGraph->GetColumns();
+		context.destinationRow = context.destinationIdx / m_pGraph->GetColumns();
+
+		context.openList.Push(context.startIdx, NodeRecord{ context.startIdx, invalid_node_index, 0.f, GetHeuristicCost(context.startIdx, context) });
 	}
 
-	template <class T_NodeType, class T_ConnectionType>
-	float Elite::ThetaStar<T_NodeType, T_ConnectionType>::GetHeuristicCost(T_NodeType* pStartNode, T_NodeType* pEndNode) const
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	SearchStatus ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::Step(int maxExpansions, Context& context) const
 	{
-		Vector2 toDestination = m_pGraph->GetNodePos(pEndNode) - m_pGraph->GetNodePos(pStartNode);
-		return m_HeuristicFunction(abs(toDestination.x), abs(toDestination.y));
+		return Expand(context, [maxExpansions](int nrOfExpansions) { return nrOfExpansions >= maxExpansions; });
 	}
 
-	template <typename T_NodeType, typename T_ConnectionType>
-	typename ThetaStar<T_NodeType, T_ConnectionType>::NodeRecord Elite::ThetaStar<T_NodeType, T_ConnectionType>::GetClosestToDestination(T_NodeType* pStartNode, T_NodeType* pDestinationNode, const VisitedUMap& visited) const
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	SearchStatus ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::StepFor(int maxMicroseconds, Context& context) const
 	{
-		if (visited.size() > 0)
+		const auto endTime = std::chrono::high_resolution_clock::now() + std::chrono::microseconds(maxMicroseconds);
+		return Expand(context, [&endTime](int nrOfExpansions)
 		{
-			auto lambdaClosest = [&](const std::pair<T_NodeType* const, NodeRecord>& nodePair1, const std::pair<T_NodeType* const, NodeRecord>& nodePair2)
+			return (nrOfExpansions % ClockCheckInterval) == 0 && std::chrono::high_resolution_clock::now() >= endTime;
+		});
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::GetPath(std::vector<T_NodeType*>& path, const Context& context) const
+	{
+		const auto& closedList{ context.closedList };
+		path.clear();
+
+		//If the search didn't get there (yet), the path goes to the closest node it expanded, the start when it didn't expand any
+		const int lastIdx{ closedList.Contains(context.destinationIdx) ? context.destinationIdx : context.closestIdx };
+		for (int idx{ (lastIdx != invalid_node_index) ? lastIdx : context.startIdx }; idx != context.startIdx; idx = closedList.Get(idx).parentIdx)
+			path.push_back(m_pGraph->GetNode(idx));
+		path.push_back(m_pGraph->GetNode(context.startIdx));
+		std::reverse(path.begin(), path.end());
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	template <class T_Function>
+	SearchStatus ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::Expand(Context& context, T_Function&& isOutOfBudget) const
+	{
+		//Same algorithm structures as A*
+		//expect for the UpdateNode step
+		if (context.status != SearchStatus::InProgress)
+			return context.status;
+
+		auto& openList{ context.openList };
+		auto& closedList{ context.closedList };
+
+		int nrOfExpansions{ 0 };
+		while (!openList.Empty())
+		{
+			if (isOutOfBudget(nrOfExpansions))
+				return SearchStatus::InProgress;
+
+			if (m_MaxNrOfExpansions > 0 && context.statistics.nrOfExpandedNodes >= m_MaxNrOfExpansions)
+				break;
+
+			const NodeRecord currentNodeRecord{ openList.Pop() };
+			closedList.Add(currentNodeRecord.nodeIdx, currentNodeRecord);
+			++context.statistics.nrOfExpandedNodes;
+			++nrOfExpansions;
+
+			const float heuristicCost{ currentNodeRecord.estimatedTotalCost - currentNodeRecord.costSoFar };
+			context.UpdateClosestNode(currentNodeRecord.nodeIdx, heuristicCost);
+
+			if (currentNodeRecord.nodeIdx == context.destinationIdx)
 			{
-				float h1{ GetHeuristicCost(nodePair1.first, pDestinationNode) };
-				float h2{ GetHeuristicCost(nodePair2.first, pDestinationNode) };
-				return h1 < h2;
-			};
+				context.status = context.isDestinationReachable ? SearchStatus::Found : SearchStatus::Failed;
+				return context.status;
+			}
+
+			m_pGraph->ForEachNeighbor(currentNodeRecord.nodeIdx, [&](int nextIdx, float connectionCost)
+			{
+				if (closedList.Contains(nextIdx) || !IsWithinSearchRadius(nextIdx, context.startIdx))
+					return;
 
-			auto cIt = std::min_element(visited.cbegin(), visited.cend(), lambdaClosest);
+				float costSoFar{ currentNodeRecord.costSoFar + connectionCost };
+				NodeRecord nr{ nextIdx, currentNodeRecord.nodeIdx, costSoFar, 0.f };
+				UpdateNode(currentNodeRecord.parentIdx, nr, context);
+				nr.estimatedTotalCost = nr.costSoFar + GetHeuristicCost(nextIdx, context);
 
-			return cIt->second;
+				if (!openList.Contains(nextIdx))
+				{
+					openList.Push(nextIdx, nr);
+				}
+				else if (openList.Get(nextIdx).costSoFar > nr.costSoFar)
+				{
+					openList.DecreaseKey(nextIdx, nr);
+				}
+			});
 		}
 
-		return NodeRecord{ pStartNode, nullptr, 0.f, GetHeuristicCost(pStartNode, pDestinationNode) };
+		context.status = SearchStatus::Failed;
+		return context.status;
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	inline float ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::GetHeuristicCost(int nodeIdx, const Context& context) const
+	{
+		return GetGridSearchHeuristicCost(m_Heuristic, m_pLandmarkHeuristic, m_pGraph->GetColumns(), nodeIdx, context);
+	}
+
+	template <class T_NodeType, class T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	inline bool ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::IsWithinSearchRadius(int idx, int startIdx) const
+	{
+		return IsWithinGridSearchRadius(m_SearchRadius, m_pGraph->GetColumns(), idx, startIdx);
 	}
 
-	template <typename T_NodeType, typename T_ConnectionType>
-	void Elite::ThetaStar<T_NodeType, T_ConnectionType>::UpdateNode(T_NodeType* pParent, NodeRecord& neighborNodeRecord, const VisitedUMap& visited)
+	template <typename T_NodeType, typename T_ConnectionType, template<class> class T_OpenList, class T_Heuristic>
+	void Elite::ThetaStar<T_NodeType, T_ConnectionType, T_OpenList, T_Heuristic>::UpdateNode(int parentIdx, NodeRecord& neighborNodeRecord, Context& context) const
 	{
 		//Update the Neighbor node according to line of sight checks
-		if (!pParent)
+		if (parentIdx == invalid_node_index)
 			return;
 
-		auto parentIt{ visited.find(pParent) };
-		const NodeRecord& parentNr{ parentIt->second };
+		const NodeRecord& parentNr{ context.closedList.Get(parentIdx) };
+		T_NodeType* pParent{ m_pGraph->GetNode(parentIdx) };
+		T_NodeType* pNode{ m_pGraph->GetNode(neighborNodeRecord.nodeIdx) };
 
 		float newCostSoFar{};
-		if (PathFindingUtils::HasLineOfSight(m_pGraph, pParent, neighborNodeRecord.pNode)) //Extended Bresenham's line algorithm
+		++context.statistics.nrOfLineOfSightChecks;
+		bool hasLineOfSight{ m_pLineOfSightCache ? m_pLineOfSightCache->HasLineOfSight(pParent, pNode)
+			: PathFindingUtils::HasLineOfSight(m_pGraph, pParent, pNode) }; //Extended Bresenham's line algorithm
+		if (hasLineOfSight)
 		{
-			Vector2 toDestination = m_pGraph->GetNodePos(neighborNodeRecord.pNode) - m_pGraph->GetNodePos(pParent);
+			Vector2 toDestination = m_pGraph->GetNodePos(pNode) - m_pGraph->GetNodePos(pParent);
 			newCostSoFar = parentNr.costSoFar + HeuristicFunctions::Euclidean(abs(toDestination.x), abs(toDestination.y));
 			if (newCostSoFar <= neighborNodeRecord.costSoFar) // replace if it is equal to lower the number of nodes in the path (happens with purely vertical or horizontal lines)
 			{
-				neighborNodeRecord.pParent = pParent;
+				neighborNodeRecord.parentIdx = parentIdx;
 				neighborNodeRecord.costSoFar = newCostSoFar;
 			}
 		}
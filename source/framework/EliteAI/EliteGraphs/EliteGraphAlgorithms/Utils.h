@@ -1,23 +1,40 @@
 #pragma once
 #include "../EGridGraph.h"
 
+namespace Elite
+{
+	template<class T_NodeType, class T_ConnectionType>
+	class LineOfSightCache;
+}
+
 namespace PathFindingUtils
 {
 	template<typename T_NodeType, typename T_ConnectionType>
 	bool HasLineOfSight(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, T_NodeType* pStartNode, T_NodeType* pTargetNode);
 
+	//Walks a supercover line as runs of cells along its major axis, isRunWalkable(minor, firstMajor, lastMajor) tests one run
+	template<typename T_Function>
+	bool AreLineRunsWalkable(int major, int minor, int majorDistance, int minorDistance, int majorStep, int minorStep, int sideThreshold, T_Function&& isRunWalkable);
+
 	template<typename T_NodeType, typename T_ConnectionType>
 	std::vector<T_NodeType*> SmoothPath(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, const std::vector<T_NodeType*>& path);
+
+	//Writes the smoothed path in a caller provided buffer, smoothedPath can't be the same vector as path
+	//The line of sight checks go through pCache when one is given (include LineOfSightCache.h to create one)
+	template<typename T_NodeType, typename T_ConnectionType>
+	void SmoothPath(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, const std::vector<T_NodeType*>& path, std::vector<T_NodeType*>& smoothedPath,
+		Elite::LineOfSightCache<T_NodeType, T_ConnectionType>* pCache = nullptr);
 }
 
 template<typename T_NodeType, typename T_ConnectionType>
 bool PathFindingUtils::HasLineOfSight(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, T_NodeType* pStartNode, T_NodeType* pTargetNode)
 {
 	//Determine if the targetNode is in line of sight of StartNode, if the stariught line traced from start to target doesn't intersect a wall
-	//If no connection exist between 2 adjacent cells, it means the cell is a wall (isolated)
+	//A wall is a cell that isn't walkable, the start cell has to be walkable as well to leave it
 	//Based on Bresenham's line algorithm: https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
 	//Acuuracy improved using Bresenham-based supercover line algorithm: http://eugen.dedu.free.fr/projects/bresenham/
 	//The modified algorithm provide more accuracy as Bresenham's might miss cells when steping both horizontally and vertically
+	//The cells the line covers in one row (or column for steep lines) are consecutive, so every row is tested as one run of bits
 	Vector2 startPos{ pGridGraph->GetNodePos(pStartNode) };
 	Vector2 endPos{ pGridGraph->GetNodePos(pTargetNode) };
 
@@ -25,83 +42,90 @@ bool PathFindingUtils::HasLineOfSight(const Elite::GridGraph<T_NodeType, T_Conne
 	int y{ int(startPos.y) };
 	int dx{ int(endPos.x) - x };
 	int dy{ int(endPos.y) - y };
-	int stepX, stepY, error, errorprev, ddy, ddx;
-	int prevX{ x }, prevY{ y };
+	int stepX{ (dx < 0) ? -1 : 1 };
+	int stepY{ (dy < 0) ? -1 : 1 };
+	dx *= stepX;
+	dy *= stepY;
 
-	if (dy < 0) {
-		stepY = -1;
-		dy = -dy;
-	}
-	else
-		stepY = 1;
+	if (dx == 0 && dy == 0)
+		return true;
 
-	if (dx < 0) {
-		stepX = -1;
-		dx = -dx;
-	}
-	else
-		stepX = 1;
-
-	ddy = 2 * dy;
-	ddx = 2 * dx;
-	if (ddx >= ddy) {
-		errorprev = error = dx;
-		for (int i = 0; i < dx; i++) {
-			x += stepX;
-			error += ddy;
-			if (error > ddx) {
-				y += stepY;
-				error -= ddx;
-				if ((error + errorprev < ddy && pGridGraph->IsWithinBounds(x, y - stepY) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x, y - stepY)))
-					|| (error + errorprev > ddy && pGridGraph->IsWithinBounds(x - stepX, y) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x - stepX, y))))
-					return false;
-			}
-
-			if (pGridGraph->IsWithinBounds(x, y) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x, y)))
-				return false;
-			errorprev = error;
-			prevX = x;
-			prevY = y;
-		}
+	if (dx >= dy)
+	{
+		return AreLineRunsWalkable(x, y, dx, dy, stepX, stepY, 2 * dy, [pGridGraph](int row, int firstCol, int lastCol)
+		{
+			return pGridGraph->IsRowRunWalkable(row, firstCol, lastCol);
+		});
 	}
-	else {
-		errorprev = error = dy;
-		for (int i = 0; i < dy; i++) {
-			y += stepY;
-			error += ddx;
-			if (error > ddy) {
-				x += stepX;
-				error -= ddy;
-				if ((error + errorprev < ddy && pGridGraph->IsWithinBounds(x - stepX, y) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x - stepX, y)))
-					|| (error + errorprev > ddy && pGridGraph->IsWithinBounds(x, y - stepY) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x, y - stepY))))
-					return false;
-			}
-
-			if (pGridGraph->IsWithinBounds(x, y) && !pGridGraph->GetConnection(pGridGraph->GetIndex(prevX, prevY), pGridGraph->GetIndex(x, y)))
-				return false;
-			errorprev = error;
-			prevX = x;
-			prevY = y;
+
+	return AreLineRunsWalkable(y, x, dy, dx, stepY, stepX, 2 * dy, [pGridGraph](int col, int firstRow, int lastRow)
+	{
+		return pGridGraph->IsColumnRunWalkable(col, firstRow, lastRow);
+	});
+}
+
+template<typename T_Function>
+bool PathFindingUtils::AreLineRunsWalkable(int major, int minor, int majorDistance, int minorDistance, int majorStep, int minorStep, int sideThreshold, T_Function&& isRunWalkable)
+{
+	//Same error terms as the step by step supercover line, but all the steps until the next minor step are taken at once
+	//error + errorprev of the step that moves along the minor axis decides which extra cell is covered:
+	//below the threshold the cell at the end of the old run, above it the cell before the start of the new run, on it neither
+	const int ddMajor{ 2 * majorDistance };
+	const int ddMinor{ 2 * minorDistance };
+	int error{ majorDistance };
+	int remainingSteps{ majorDistance };
+	int runStart{ major };
+
+	while (true)
+	{
+		int stepsToMinorStep{ (ddMinor > 0) ? (ddMajor - error) / ddMinor + 1 : remainingSteps + 1 };
+		if (stepsToMinorStep > remainingSteps)
+		{
+			int runEnd{ major + remainingSteps * majorStep };
+			return isRunWalkable(minor, (runStart < runEnd) ? runStart : runEnd, (runStart < runEnd) ? runEnd : runStart);
 		}
-	}
 
-	return true;
+		int errorPrev{ error + (stepsToMinorStep - 1) * ddMinor };
+		int newError{ errorPrev + ddMinor - ddMajor };
+		int newMajor{ major + stepsToMinorStep * majorStep };
+
+		int runEnd{ (newError + errorPrev < sideThreshold) ? newMajor : newMajor - majorStep };
+		if (!isRunWalkable(minor, (runStart < runEnd) ? runStart : runEnd, (runStart < runEnd) ? runEnd : runStart))
+			return false;
+
+		runStart = (newError + errorPrev > sideThreshold) ? newMajor - majorStep : newMajor;
+		minor += minorStep;
+		major = newMajor;
+		error = newError;
+		remainingSteps -= stepsToMinorStep;
+	}
 }
 
 template<typename T_NodeType, typename T_ConnectionType>
 std::vector<T_NodeType*> PathFindingUtils::SmoothPath(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, const std::vector<T_NodeType*>& path)
 {
+	std::vector<T_NodeType*> smoothedPath{};
+	SmoothPath(pGridGraph, path, smoothedPath);
+
+	return smoothedPath;
+}
+
+template<typename T_NodeType, typename T_ConnectionType>
+void PathFindingUtils::SmoothPath(const Elite::GridGraph<T_NodeType, T_ConnectionType>* pGridGraph, const std::vector<T_NodeType*>& path, std::vector<T_NodeType*>& smoothedPath,
+	Elite::LineOfSightCache<T_NodeType, T_ConnectionType>* pCache)
+{
+	smoothedPath.clear();
 	if (path.empty())
-		return path;
+		return;
 
-	std::vector<T_NodeType*> smoothedPath{};
 	size_t anchorIdx{ 0 };
 	smoothedPath.push_back(path[anchorIdx]);
 
 	size_t pathSize{ path.size() };
 	for (size_t idx{ 1 }; idx < pathSize;)
 	{
-		if (!HasLineOfSight(pGridGraph, path[anchorIdx], path[idx]))
+		bool hasLineOfSight{ pCache ? pCache->HasLineOfSight(path[anchorIdx], path[idx]) : HasLineOfSight(pGridGraph, path[anchorIdx], path[idx]) };
+		if (!hasLineOfSight)
 		{
 			anchorIdx = idx - 1;
 			smoothedPath.push_back(path[anchorIdx]);
@@ -110,6 +134,4 @@ std::vector<T_NodeType*> PathFindingUtils::SmoothPath(const Elite::GridGraph<T_N
 		++idx;
 	}
 	smoothedPath.push_back(path[pathSize - 1]);
-
-	return smoothedPath;
 }
\ No newline at end of file
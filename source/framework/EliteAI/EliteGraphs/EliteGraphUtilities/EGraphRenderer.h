@@ -73,22 +73,22 @@ namespace Elite
 		{
 			for (auto node : pGraph->GetAllNodes())
 			{
-				//Connections
-				for (auto con : pGraph->GetNodeConnections(node->GetIndex()))
+				//Connections, an implicit grid has no connection objects so walk the neighbors instead
+				pGraph->ForEachNeighbor(node->GetIndex(), [&](int toIdx, float cost)
 				{
 					std::string text{ };
 					if (renderConnectionsCosts)
 					{
 						std::stringstream ss;
-						ss << std::fixed << std::setprecision(1) << con->GetCost();
+						ss << std::fixed << std::setprecision(1) << cost;
 						text = ss.str();
 					}
-					RenderConnection(con,
-						pGraph->GetNodeWorldPos(con->GetTo()),
-						pGraph->GetNodeWorldPos(con->GetFrom()),
+					RenderConnection(nullptr,
+						pGraph->GetNodeWorldPos(toIdx),
+						pGraph->GetNodeWorldPos(node->GetIndex()),
 						text
 					);
-				}
+				});
 			}
 		}
 	}
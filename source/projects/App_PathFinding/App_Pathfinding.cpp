@@ -4,14 +4,43 @@
 //Includes
 #include "App_Pathfinding.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\EAstar.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\BidirectionalAStar.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\ThetaStar.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\LazyThetaStar.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\JumpPointSearch.h"
 #include <numeric>
+#ifdef _DEBUG
+#include <crtdbg.h>
+#endif
 
 using namespace Elite;
 
+#ifdef _DEBUG
+//Debug CRT allocation hook of the allocation check, it sees every form of new and malloc without replacing them.
+//Only the allocations of the thread that runs the check are counted, the other threads allocate as usual
+namespace
+{
+	thread_local bool s_IsCountingAllocations = false;
+	int s_NrOfAllocations = 0;
+	_CRT_ALLOC_HOOK s_pPreviousAllocHook = nullptr;
+
+	int __cdecl CountAllocations(int allocType, void* pUserData, size_t size, int blockType, long requestNumber, const unsigned char* pFileName, int lineNumber)
+	{
+		if (s_IsCountingAllocations && (allocType == _HOOK_ALLOC || allocType == _HOOK_REALLOC))
+			++s_NrOfAllocations;
+
+		return s_pPreviousAllocHook ? s_pPreviousAllocHook(allocType, pUserData, size, blockType, requestNumber, pFileName, lineNumber) : TRUE;
+	}
+}
+#endif
+
 //Destructor
 App_Pathfinding::~App_Pathfinding()
 {
+	SAFE_DELETE(m_pHPAStar);
+	SAFE_DELETE(m_pDStarLite);
+	SAFE_DELETE(m_pLandmarkHeuristic);
+	SAFE_DELETE(m_pLineOfSightCache);
 	SAFE_DELETE(m_pGridGraph);
 }
 
@@ -27,6 +56,11 @@ void App_Pathfinding::Start()
 
 	startPathIdx = 0;
 	endPathIdx = 4;
+
+#ifdef _DEBUG
+	//Every debug run checks that warm queries don't allocate, the button runs the check again after the grid was edited
+	RunAllocationCheck();
+#endif
 }
 
 void App_Pathfinding::Update(float deltaTime)
@@ -72,29 +106,76 @@ void App_Pathfinding::Update(float deltaTime)
 		&& endPathIdx != invalid_node_index
 		&& startPathIdx != endPathIdx)
 	{
-		const int iterations{ 100 };
-		std::chrono::high_resolution_clock::time_point t1, t2;
-		float min = FLT_MAX, max = 0.f, total = 0.f, duration;
+		//Every combination of open list and heuristic is its own instantiation, so the searches inline both
+		using CalculatePathsFunction = void (App_Pathfinding::*)();
+		static const CalculatePathsFunction calculatePaths[3][5]
+		{
+			{
+				&App_Pathfinding::CalculatePaths<BinaryHeap, ManhattanHeuristic>, &App_Pathfinding::CalculatePaths<BinaryHeap, EuclideanHeuristic>,
+				&App_Pathfinding::CalculatePaths<BinaryHeap, SqrtEuclideanHeuristic>, &App_Pathfinding::CalculatePaths<BinaryHeap, OctileHeuristic>,
+				&App_Pathfinding::CalculatePaths<BinaryHeap, ChebyshevHeuristic>
+			},
+			{
+				&App_Pathfinding::CalculatePaths<QuaternaryHeap, ManhattanHeuristic>, &App_Pathfinding::CalculatePaths<QuaternaryHeap, EuclideanHeuristic>,
+				&App_Pathfinding::CalculatePaths<QuaternaryHeap, SqrtEuclideanHeuristic>, &App_Pathfinding::CalculatePaths<QuaternaryHeap, OctileHeuristic>,
+				&App_Pathfinding::CalculatePaths<QuaternaryHeap, ChebyshevHeuristic>
+			},
+			{
+				&App_Pathfinding::CalculatePaths<PairingHeap, ManhattanHeuristic>, &App_Pathfinding::CalculatePaths<PairingHeap, EuclideanHeuristic>,
+				&App_Pathfinding::CalculatePaths<PairingHeap, SqrtEuclideanHeuristic>, &App_Pathfinding::CalculatePaths<PairingHeap, OctileHeuristic>,
+				&App_Pathfinding::CalculatePaths<PairingHeap, ChebyshevHeuristic>
+			}
+		};
+		(this->*calculatePaths[int(m_OpenListType)][m_SelectedHeuristic])();
 
-		auto startNode = m_pGridGraph->GetNode(startPathIdx);
-		auto endNode = m_pGridGraph->GetNode(endPathIdx);
+		m_UpdatePath = false;
+		std::cout << "New Path Calculated" << std::endl;
+	}
+}
 
-		if (m_PathFindingAlgo != PathfindingAlgorithm::THETASTAR)
-		{
-			auto pathfinder = AStar<GridTerrainNode, GraphConnection>(m_pGridGraph, m_pHeuristicFunction);
+template<template<class> class T_OpenList, class T_Heuristic>
+void App_Pathfinding::CalculatePaths()
+{
+	const int iterations{ 100 };
+	std::chrono::high_resolution_clock::time_point t1, t2;
+	float min = FLT_MAX, max = 0.f, total = 0.f, duration;
 
-			min = FLT_MAX;
-			max = 0.f;
-			total = 0.f;
-			duration = 0.f;
+	auto startNode = m_pGridGraph->GetNode(startPathIdx);
+	auto endNode = m_pGridGraph->GetNode(endPathIdx);
 
+	//Buffers reused by every iteration, so only the first search allocates
+	std::vector<GridTerrainNode*> path{}, smoothedPath{};
+
+	//Cached line of sight results are kept between updates, edits of the grid only drop the results they affect
+	LineOfSightCache<GridTerrainNode, GraphConnection>* pLineOfSightCache{ m_UseLineOfSightCache ? m_pLineOfSightCache : nullptr };
+	m_pLineOfSightCache->ResetStatistics();
+
+	const LandmarkHeuristic<GridTerrainNode, GraphConnection>* pLandmarkHeuristic{ nullptr };
+	if (m_UseLandmarks)
+	{
+		if (!m_pLandmarkHeuristic)
+			m_pLandmarkHeuristic = new LandmarkHeuristic<GridTerrainNode, GraphConnection>(m_pGridGraph);
+		m_pLandmarkHeuristic->Update();
+		pLandmarkHeuristic = m_pLandmarkHeuristic;
+	}
+
+	if (IsAStarSelected())
+	{
+		min = FLT_MAX;
+		max = 0.f;
+		total = 0.f;
+		duration = 0.f;
+
+		//A* and bidirectional A* share the benchmark, only the pathfinder type differs
+		auto benchmarkAStar = [&](auto& pathfinder)
+		{
 			if (m_SmoothAstar) //Take smoothing into account for benchmarking
 			{
 				for (int count{}; count < iterations; ++count)
 				{
 					t1 = std::chrono::high_resolution_clock::now();
-					auto path = pathfinder.FindPath(startNode, endNode);
-					path = PathFindingUtils::SmoothPath(m_pGridGraph, path);
+					pathfinder.FindPath(startNode, endNode, path);
+					PathFindingUtils::SmoothPath(m_pGridGraph, path, smoothedPath, pLineOfSightCache);
 					t2 = std::chrono::high_resolution_clock::now();
 					duration = std::chrono::duration<float>(t2 - t1).count();
 
@@ -107,15 +188,15 @@ void App_Pathfinding::Update(float deltaTime)
 					total += duration;
 				}
 
-				m_vPathAStar = pathfinder.FindPath(startNode, endNode);
-				m_vPathAStar = PathFindingUtils::SmoothPath(m_pGridGraph, m_vPathAStar);
+				pathfinder.FindPath(startNode, endNode, path);
+				PathFindingUtils::SmoothPath(m_pGridGraph, path, m_vPathAStar, pLineOfSightCache);
 			}
 			else
 			{
 				for (int count{}; count < iterations; ++count)
 				{
 					t1 = std::chrono::high_resolution_clock::now();
-					auto path = pathfinder.FindPath(startNode, endNode);
+					pathfinder.FindPath(startNode, endNode, path);
 					t2 = std::chrono::high_resolution_clock::now();
 					duration = std::chrono::duration<float>(t2 - t1).count();
 
@@ -131,28 +212,80 @@ void App_Pathfinding::Update(float deltaTime)
 				m_vPathAStar = pathfinder.FindPath(startNode, endNode);
 			}
 
-			m_ExecutionTimeAStar = (total - min - max) / (iterations - 2);
+			m_NrOfExpandedNodesAStar = pathfinder.GetStatistics().nrOfExpandedNodes;
+		};
 
-			size_t pathSize{ m_vPathAStar.size() };
-			m_PathLengthAStar = 0.f;
-			for (size_t idx{ 1 }; idx < pathSize; ++idx)
-			{
-				m_PathLengthAStar += Elite::Distance(m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx-1]), m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx]));
-			}
+		switch (m_AStarVariant)
+		{
+		case AStarVariant::BIDIRECTIONAL:
+		{
+			auto pathfinder = BidirectionalAStar<GridTerrainNode, GraphConnection, T_OpenList>(m_pGridGraph, m_pHeuristicFunction);
+			benchmarkAStar(pathfinder);
+			break;
+		}
+		case AStarVariant::HIERARCHICAL:
+		{
+			//The abstraction always uses binary heaps, the first search applies the edits of the grid
+			if (!m_pHPAStar)
+				m_pHPAStar = new HPAStar<GridTerrainNode, GraphConnection>(m_pGridGraph, m_pHeuristicFunction, 5);
+			benchmarkAStar(*m_pHPAStar);
+			m_NrOfRebuiltClusters = m_pHPAStar->GetNrOfRebuiltClusters();
+			break;
+		}
+		case AStarVariant::ARASTAR:
+		{
+			auto pathfinder = ARAStar<GridTerrainNode, GraphConnection, T_OpenList>(m_pGridGraph, m_pHeuristicFunction);
+			pathfinder.SetTimeBudget(m_TimeBudgetARAStar);
+			benchmarkAStar(pathfinder);
+			m_SuboptimalityBound = pathfinder.GetSuboptimalityBound();
+			break;
+		}
+		case AStarVariant::DSTARLITE:
+		{
+			//Only the first query repairs the search after an edit, the benchmark measures queries on an unchanged grid
+			if (!m_pDStarLite)
+				m_pDStarLite = new DStarLite<GridTerrainNode, GraphConnection>(m_pGridGraph, m_pHeuristicFunction);
+			m_pDStarLite->FindPath(startNode, endNode, path);
+			m_NrOfRepairedNodes = m_pDStarLite->GetStatistics().nrOfExpandedNodes;
+			benchmarkAStar(*m_pDStarLite);
+			break;
+		}
+		default:
+		{
+			auto pathfinder = AStar<GridTerrainNode, GraphConnection, T_OpenList, T_Heuristic>(m_pGridGraph, m_pHeuristicFunction);
+			pathfinder.SetLandmarkHeuristic(pLandmarkHeuristic);
+			pathfinder.SetHeuristicWeight(m_HeuristicWeight);
+			benchmarkAStar(pathfinder);
+			break;
+		}
 		}
 
-		if (m_PathFindingAlgo != PathfindingAlgorithm::ASTAR)
+		m_ExecutionTimeAStar = (total - min - max) / (iterations - 2);
+
+		size_t pathSize{ m_vPathAStar.size() };
+		m_PathLengthAStar = 0.f;
+		for (size_t idx{ 1 }; idx < pathSize; ++idx)
 		{
-			auto pathfinder = ThetaStar<GridTerrainNode, GraphConnection>(m_pGridGraph, m_pHeuristicFunction);
+			m_PathLengthAStar += Elite::Distance(m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx-1]), m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx]));
+		}
+	}
 
-			min = FLT_MAX;
-			max = 0.f;
-			total = 0.f;
-			duration = 0.f;
-			for (int count{}; count < iterations; ++count) 
+	if (IsThetaStarSelected())
+	{
+		min = FLT_MAX;
+		max = 0.f;
+		total = 0.f;
+		duration = 0.f;
+
+		//Theta* and Lazy Theta* share the benchmark, only the pathfinder type differs
+		auto benchmarkThetaStar = [&](auto& pathfinder)
+		{
+			pathfinder.SetLineOfSightCache(pLineOfSightCache);
+			pathfinder.SetLandmarkHeuristic(pLandmarkHeuristic);
+			for (int count{}; count < iterations; ++count)
 			{
 				t1 = std::chrono::high_resolution_clock::now();
-				pathfinder.FindPath(startNode, endNode);
+				pathfinder.FindPath(startNode, endNode, path);
 				t2 = std::chrono::high_resolution_clock::now();
 				duration = std::chrono::duration<float>(t2 - t1).count();
 
@@ -165,19 +298,70 @@ void App_Pathfinding::Update(float deltaTime)
 				total += duration;
 			}
 
-			m_ExecutionTimeThetaStar = (total - min - max) / (iterations - 2);
 			m_vPathThetaStar = pathfinder.FindPath(startNode, endNode);
+			m_NrOfLineOfSightChecksThetaStar = pathfinder.GetStatistics().nrOfLineOfSightChecks;
+		};
 
-			size_t pathSize{ m_vPathThetaStar.size() };
-			m_PathLengthThetaStar = 0.f;
-			for (size_t idx{ 1 }; idx < pathSize; ++idx)
-			{
-				m_PathLengthThetaStar += Elite::Distance(m_pGridGraph->GetNodeWorldPos(m_vPathThetaStar[idx - 1]), m_pGridGraph->GetNodeWorldPos(m_vPathThetaStar[idx]));
-			}
+		if (m_LazyThetaStar)
+		{
+			auto pathfinder = LazyThetaStar<GridTerrainNode, GraphConnection, T_OpenList, T_Heuristic>(m_pGridGraph, m_pHeuristicFunction);
+			benchmarkThetaStar(pathfinder);
+		}
+		else
+		{
+			auto pathfinder = ThetaStar<GridTerrainNode, GraphConnection, T_OpenList, T_Heuristic>(m_pGridGraph, m_pHeuristicFunction);
+			benchmarkThetaStar(pathfinder);
 		}
 
-		m_UpdatePath = false;
-		std::cout << "New Path Calculated" << std::endl;
+		m_ExecutionTimeThetaStar = (total - min - max) / (iterations - 2);
+		m_LineOfSightCacheStatistics = m_pLineOfSightCache->GetStatistics();
+
+		size_t pathSize{ m_vPathThetaStar.size() };
+		m_PathLengthThetaStar = 0.f;
+		for (size_t idx{ 1 }; idx < pathSize; ++idx)
+		{
+			m_PathLengthThetaStar += Elite::Distance(m_pGridGraph->GetNodeWorldPos(m_vPathThetaStar[idx - 1]), m_pGridGraph->GetNodeWorldPos(m_vPathThetaStar[idx]));
+		}
+	}
+
+	if (IsJPSSelected())
+	{
+		auto pathfinder = JumpPointSearch<GridTerrainNode, GraphConnection, T_OpenList>(m_pGridGraph, m_pHeuristicFunction, m_UseJumpTable);
+		m_CanJump = pathfinder.CanJump();
+
+		//Build the JPS+ table up front, it is only recomputed when the grid changes
+		if (m_UseJumpTable && m_CanJump)
+			pathfinder.UpdateJumpTable();
+
+		min = FLT_MAX;
+		max = 0.f;
+		total = 0.f;
+		duration = 0.f;
+		for (int count{}; count < iterations; ++count)
+		{
+			t1 = std::chrono::high_resolution_clock::now();
+			pathfinder.FindPath(startNode, endNode, path);
+			t2 = std::chrono::high_resolution_clock::now();
+			duration = std::chrono::duration<float>(t2 - t1).count();
+
+			if (duration < min)
+				min = duration;
+
+			if (duration > max)
+				max = duration;
+
+			total += duration;
+		}
+
+		m_ExecutionTimeJPS = (total - min - max) / (iterations - 2);
+		m_vPathJPS = pathfinder.FindPath(startNode, endNode);
+
+		size_t pathSize{ m_vPathJPS.size() };
+		m_PathLengthJPS = 0.f;
+		for (size_t idx{ 1 }; idx < pathSize; ++idx)
+		{
+			m_PathLengthJPS += Elite::Distance(m_pGridGraph->GetNodeWorldPos(m_vPathJPS[idx - 1]), m_pGridGraph->GetNodeWorldPos(m_vPathJPS[idx]));
+		}
 	}
 }
 
@@ -206,7 +390,7 @@ void App_Pathfinding::Render(float deltaTime) const
 	}
 	
 	//render path below if applicable
-	if (m_PathFindingAlgo != PathfindingAlgorithm::ASTAR && m_vPathThetaStar.size() > 0)
+	if (IsThetaStarSelected() && m_vPathThetaStar.size() > 0)
 	{
 		Elite::Color pathColor{ 0.f, 1.f, 0.f };
 		m_GraphRenderer.RenderHighlightedGrid(m_pGridGraph, m_vPathThetaStar, pathColor);
@@ -218,7 +402,7 @@ void App_Pathfinding::Render(float deltaTime) const
 		}
 	}
 
-	if (m_PathFindingAlgo != PathfindingAlgorithm::THETASTAR && m_vPathAStar.size() > 0)
+	if (IsAStarSelected() && m_vPathAStar.size() > 0)
 	{
 		Elite::Color pathColor{ 0.f, 0.f, 1.f };
 		m_GraphRenderer.RenderHighlightedGrid(m_pGridGraph, m_vPathAStar, pathColor);
@@ -229,11 +413,141 @@ void App_Pathfinding::Render(float deltaTime) const
 			DEBUGRENDERER2D->DrawSegment(m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx - 1]), m_pGridGraph->GetNodeWorldPos(m_vPathAStar[idx]), pathColor, 0.f);
 		}
 	}
+
+	if (IsJPSSelected() && m_vPathJPS.size() > 0)
+	{
+		Elite::Color pathColor{ 1.f, 0.5f, 0.f };
+		m_GraphRenderer.RenderHighlightedGrid(m_pGridGraph, m_vPathJPS, pathColor);
+
+		size_t pathSize{ m_vPathJPS.size() };
+		for (size_t idx{ 1 }; idx < pathSize; ++idx)
+		{
+			DEBUGRENDERER2D->DrawSegment(m_pGridGraph->GetNodeWorldPos(m_vPathJPS[idx - 1]), m_pGridGraph->GetNodeWorldPos(m_vPathJPS[idx]), pathColor, 0.f);
+		}
+	}
 }
 
+void App_Pathfinding::RunBatchBenchmark()
+{
+	using Grid = GridGraph<GridTerrainNode, GraphConnection>;
+	using BatchAStar = BatchPathfinder<GridTerrainNode, AStar<GridTerrainNode, GraphConnection>>;
+
+	//A fifth of the cells are walls, so the searches have to go around obstacles
+	Grid* pGrid{ new Grid(BATCH_BENCHMARK_SIZE, BATCH_BENCHMARK_SIZE, 1, false, true, 1.f, 1.5f) };
+	std::mt19937 generator{ 42 };
+	std::uniform_int_distribution<int> distribution{ 0, pGrid->GetNrOfNodes() - 1 };
+	for (int count{}; count < pGrid->GetNrOfNodes() / 5; ++count)
+	{
+		const int idx{ distribution(generator) };
+		pGrid->GetNode(idx)->SetTerrainType(TerrainType::Wall);
+		pGrid->IsolateNode(idx);
+	}
+
+	//The same walkable start and end cells for every pool size
+	std::vector<BatchAStar::Query> queries{};
+	queries.reserve(NR_OF_BATCH_QUERIES);
+	for (int attempt{}; attempt < NR_OF_BATCH_QUERIES * 16 && int(queries.size()) < NR_OF_BATCH_QUERIES; ++attempt)
+	{
+		const int startIdx{ distribution(generator) };
+		const int endIdx{ distribution(generator) };
+		if (pGrid->IsWalkable(startIdx) && pGrid->IsWalkable(endIdx))
+			queries.push_back(BatchAStar::Query{ pGrid->GetNode(startIdx), pGrid->GetNode(endIdx) });
+	}
+
+	AStar<GridTerrainNode, GraphConnection> pathfinder{ pGrid, m_pHeuristicFunction };
+	std::vector<std::vector<GridTerrainNode*>> paths{};
+	m_BatchBenchmarkTimes.clear();
+	for (int nrOfThreads : { 1, 2, 4, 8, 16 })
+	{
+		BatchAStar batchPathfinder{ &pathfinder, nrOfThreads };
+
+		//The first batch lets the contexts and paths grow, the second one is measured
+		batchPathfinder.FindPaths(queries, paths);
+		const auto t1 = std::chrono::high_resolution_clock::now();
+		batchPathfinder.FindPaths(queries, paths);
+		const auto t2 = std::chrono::high_resolution_clock::now();
+
+		m_BatchBenchmarkTimes.push_back(std::make_pair(nrOfThreads, std::chrono::duration<float>(t2 - t1).count()));
+	}
+
+	SAFE_DELETE(pGrid);
+}
+
+void App_Pathfinding::RunConstructionBenchmark()
+{
+	using Grid = GridGraph<GridTerrainNode, GraphConnection>;
+
+	//A 2048x2048 grid with connections takes about 1.5GB, more than a 32 bit build can address
+	const int maxSize{ (sizeof(void*) == 8) ? 2048 : 1024 };
+	auto measure = [](int size, bool isImplicit, int nrOfThreads)
+	{
+		const auto t1 = std::chrono::high_resolution_clock::now();
+		Grid* pGrid{ new Grid(size, size, 1, false, true, 1.f, 1.5f, isImplicit, nrOfThreads) };
+		const auto t2 = std::chrono::high_resolution_clock::now();
+		SAFE_DELETE(pGrid);
+		return std::chrono::duration<float>(t2 - t1).count();
+	};
+
+	m_ConstructionBenchmarkTimes.clear();
+	for (int size{ 256 }; size <= maxSize; size *= 2)
+		m_ConstructionBenchmarkTimes.push_back(ConstructionTime{ size, measure(size, false, 1), measure(size, false, 0), measure(size, true, 1) });
+}
+
+#ifdef _DEBUG
+void App_Pathfinding::RunAllocationCheck()
+{
+	auto startNode = m_pGridGraph->GetNode(startPathIdx);
+	auto endNode = m_pGridGraph->GetNode(endPathIdx);
+
+	AStar<GridTerrainNode, GraphConnection> aStar{ m_pGridGraph, m_pHeuristicFunction };
+	ThetaStar<GridTerrainNode, GraphConnection> thetaStar{ m_pGridGraph, m_pHeuristicFunction };
+	std::vector<GridTerrainNode*> aStarPath{}, smoothedPath{}, thetaStarPath{};
+
+	//The first queries let the contexts and paths grow, the queries after them are counted
+	aStar.FindPath(startNode, endNode, aStarPath);
+	PathFindingUtils::SmoothPath(m_pGridGraph, aStarPath, smoothedPath);
+	thetaStar.FindPath(startNode, endNode, thetaStarPath);
+
+	s_NrOfAllocations = 0;
+	s_pPreviousAllocHook = _CrtSetAllocHook(CountAllocations);
+	s_IsCountingAllocations = true;
+	for (int count{}; count < NR_OF_ALLOCATION_CHECK_QUERIES; ++count)
+	{
+		aStar.FindPath(startNode, endNode, aStarPath);
+		PathFindingUtils::SmoothPath(m_pGridGraph, aStarPath, smoothedPath);
+		thetaStar.FindPath(startNode, endNode, thetaStarPath);
+	}
+	s_IsCountingAllocations = false;
+	_CrtSetAllocHook(s_pPreviousAllocHook);
+
+	m_NrOfWarmAllocations = s_NrOfAllocations;
+	assert(m_NrOfWarmAllocations == 0 && "<App_Pathfinding>: warm A*, smoothing or Theta* queries allocated");
+}
+#endif
+
 void App_Pathfinding::MakeGridGraph()
 {
 	m_pGridGraph = new GridGraph<GridTerrainNode, GraphConnection>(COLUMNS, ROWS, m_SizeCell, false, true, 1.f, 1.5f);
+	m_pLineOfSightCache = new LineOfSightCache<GridTerrainNode, GraphConnection>(m_pGridGraph);
+}
+
+bool App_Pathfinding::IsAStarSelected() const
+{
+	return m_PathFindingAlgo == PathfindingAlgorithm::BOTH
+		|| m_PathFindingAlgo == PathfindingAlgorithm::ASTAR
+		|| m_PathFindingAlgo == PathfindingAlgorithm::ASTAR_JPS;
+}
+
+bool App_Pathfinding::IsThetaStarSelected() const
+{
+	return m_PathFindingAlgo == PathfindingAlgorithm::BOTH
+		|| m_PathFindingAlgo == PathfindingAlgorithm::THETASTAR;
+}
+
+bool App_Pathfinding::IsJPSSelected() const
+{
+	return m_PathFindingAlgo == PathfindingAlgorithm::JPS
+		|| m_PathFindingAlgo == PathfindingAlgorithm::ASTAR_JPS;
 }
 
 void App_Pathfinding::UpdateImGui()
@@ -265,6 +579,9 @@ void App_Pathfinding::UpdateImGui()
 		ImGui::Indent();
 		ImGui::Text("%.3f ms/frame", 1000.0f / ImGui::GetIO().Framerate);
 		ImGui::Text("%.1f FPS", ImGui::GetIO().Framerate);
+		const GraphMemoryStatistics graphMemory{ m_pGridGraph->GetMemoryStatistics() };
+		ImGui::Text("Graph: %.2f MB", graphMemory.GetTotal() / (1024.f * 1024.f));
+		ImGui::Text("	Connections: %d (%d free)", graphMemory.nrOfConnections, graphMemory.nrOfFreeConnectionSlots);
 		ImGui::Unindent();
 
 		/*Spacing*/ImGui::Spacing(); ImGui::Separator(); ImGui::Spacing(); ImGui::Spacing();
@@ -286,7 +603,7 @@ void App_Pathfinding::UpdateImGui()
 		}
 
 		ImGui::Checkbox("Grid", &m_bDrawGrid);
-		if (ImGui::Combo("Algorithm", &m_SelectedAlgorithm, "A* & Theta*\0A*\0Theta*\0", 2))
+		if (ImGui::Combo("Algorithm", &m_SelectedAlgorithm, "A* & Theta*\0A*\0Theta*\0JPS\0A* & JPS\0", 2))
 		{
 			switch (m_SelectedAlgorithm)
 			{
@@ -299,6 +616,12 @@ void App_Pathfinding::UpdateImGui()
 			case 2:
 				m_PathFindingAlgo = PathfindingAlgorithm::THETASTAR;
 				break;
+			case 3:
+				m_PathFindingAlgo = PathfindingAlgorithm::JPS;
+				break;
+			case 4:
+				m_PathFindingAlgo = PathfindingAlgorithm::ASTAR_JPS;
+				break;
 			default:
 				m_PathFindingAlgo = PathfindingAlgorithm::BOTH;
 				break;
@@ -307,26 +630,145 @@ void App_Pathfinding::UpdateImGui()
 			m_UpdatePath = true;
 		}
 
-		if (m_PathFindingAlgo == PathfindingAlgorithm::BOTH || m_PathFindingAlgo == PathfindingAlgorithm::ASTAR)
+		if (ImGui::Combo("Open List", &m_SelectedOpenList, "Binary Heap\0Quaternary Heap\0Pairing Heap\0", 2))
+		{
+			switch (m_SelectedOpenList)
+			{
+			case 1:
+				m_OpenListType = OpenListType::QUATERNARYHEAP;
+				break;
+			case 2:
+				m_OpenListType = OpenListType::PAIRINGHEAP;
+				break;
+			default:
+				m_OpenListType = OpenListType::BINARYHEAP;
+				break;
+			}
+
+			m_UpdatePath = true;
+		}
+
+		if (IsAStarSelected())
 		{
 			if (ImGui::Checkbox("Smooth A*", &m_SmoothAstar))
 				m_UpdatePath = true;
+			if (ImGui::Combo("A* Variant", &m_SelectedAStarVariant, "A*\0Bidirectional A*\0HPA*\0D* Lite\0ARA*\0", 5))
+			{
+				switch (m_SelectedAStarVariant)
+				{
+				case 1:
+					m_AStarVariant = AStarVariant::BIDIRECTIONAL;
+					break;
+				case 2:
+					m_AStarVariant = AStarVariant::HIERARCHICAL;
+					break;
+				case 3:
+					m_AStarVariant = AStarVariant::DSTARLITE;
+					break;
+				case 4:
+					m_AStarVariant = AStarVariant::ARASTAR;
+					break;
+				default:
+					m_AStarVariant = AStarVariant::ASTAR;
+					break;
+				}
+
+				m_UpdatePath = true;
+			}
 
 			ImGui::Spacing();
-			ImGui::Text("A*: (Blue)");
+			switch (m_AStarVariant)
+			{
+			case AStarVariant::BIDIRECTIONAL:
+				ImGui::Text("Bidirectional A*: (Blue)");
+				break;
+			case AStarVariant::HIERARCHICAL:
+				ImGui::Text("HPA*: (Blue)");
+				break;
+			case AStarVariant::DSTARLITE:
+				ImGui::Text("D* Lite: (Blue)");
+				break;
+			case AStarVariant::ARASTAR:
+				ImGui::Text("ARA*: (Blue)");
+				break;
+			default:
+				ImGui::Text("A*: (Blue)");
+				break;
+			}
 			ImGui::Text("	Time: %.2fms", m_ExecutionTimeAStar * 1000.f);
 			ImGui::Text("	Length: %.2f", m_PathLengthAStar);
+			ImGui::Text("	Expanded: %d", m_NrOfExpandedNodesAStar);
+			if (m_AStarVariant == AStarVariant::HIERARCHICAL)
+				ImGui::Text("	Rebuilt clusters: %d", m_NrOfRebuiltClusters);
+			if (m_AStarVariant == AStarVariant::DSTARLITE)
+				ImGui::Text("	Repaired: %d", m_NrOfRepairedNodes);
+			if (m_AStarVariant == AStarVariant::ASTAR && ImGui::SliderFloat("Weight", &m_HeuristicWeight, 1.f, 5.f))
+				m_UpdatePath = true;
+			if (m_AStarVariant == AStarVariant::ARASTAR)
+			{
+				ImGui::Text("	Bound: %.2f", m_SuboptimalityBound);
+				if (ImGui::SliderInt("Budget (us)", &m_TimeBudgetARAStar, 0, 5000))
+					m_UpdatePath = true;
+			}
 			ImGui::Spacing();
 		}
 
-		if (m_PathFindingAlgo == PathfindingAlgorithm::BOTH || m_PathFindingAlgo == PathfindingAlgorithm::THETASTAR)
+		if (IsThetaStarSelected())
 		{
-			ImGui::Text("Theta*: (Green)");
+			if (ImGui::Checkbox("Lazy Theta*", &m_LazyThetaStar))
+				m_UpdatePath = true;
+
+			ImGui::Text(m_LazyThetaStar ? "Lazy Theta*: (Green)" : "Theta*: (Green)");
 			ImGui::Text("	Time: %.2fms", m_ExecutionTimeThetaStar * 1000.f);
 			ImGui::Text("	Length: %.2f", m_PathLengthThetaStar);
+			ImGui::Text("	LOS checks: %d", m_NrOfLineOfSightChecksThetaStar);
+			if (ImGui::Checkbox("LOS cache", &m_UseLineOfSightCache))
+				m_UpdatePath = true;
+			if (m_UseLineOfSightCache)
+			{
+				ImGui::Text("	Hit rate: %.1f%%", m_LineOfSightCacheStatistics.GetHitRate() * 100.f);
+				ImGui::Text("	Evictions: %d", m_LineOfSightCacheStatistics.nrOfEvictions);
+				ImGui::Text("	Invalidations: %d", m_LineOfSightCacheStatistics.nrOfInvalidations);
+			}
 			ImGui::Spacing();
 		}
 
+		if (IsJPSSelected())
+		{
+			if (ImGui::Checkbox("JPS+", &m_UseJumpTable))
+				m_UpdatePath = true;
+
+			ImGui::Text("JPS: (Orange)");
+			if (!m_CanJump)
+				ImGui::Text("	Mud: A* fallback");
+			ImGui::Text("	Time: %.2fms", m_ExecutionTimeJPS * 1000.f);
+			ImGui::Text("	Length: %.2f", m_PathLengthJPS);
+			ImGui::Spacing();
+		}
+
+		if (ImGui::Button("Batch benchmark"))
+			RunBatchBenchmark();
+		for (const std::pair<int, float>& batchTime : m_BatchBenchmarkTimes)
+		{
+			ImGui::Text("	%d threads: %.2fms (x%.2f)", batchTime.first, batchTime.second * 1000.f,
+				m_BatchBenchmarkTimes.front().second / batchTime.second);
+		}
+		if (ImGui::Button("Construction benchmark"))
+			RunConstructionBenchmark();
+		for (const ConstructionTime& constructionTime : m_ConstructionBenchmarkTimes)
+		{
+			ImGui::Text("	%dx%d: %.1fms", constructionTime.size, constructionTime.size, constructionTime.time * 1000.f);
+			ImGui::Text("		%d threads: %.1fms, implicit: %.1fms", int(std::thread::hardware_concurrency()),
+				constructionTime.parallelTime * 1000.f, constructionTime.implicitTime * 1000.f);
+		}
+#ifdef _DEBUG
+		if (ImGui::Button("Allocation check"))
+			RunAllocationCheck();
+		if (m_NrOfWarmAllocations >= 0)
+			ImGui::Text("	%d allocations in %d warm queries", m_NrOfWarmAllocations, NR_OF_ALLOCATION_CHECK_QUERIES);
+#endif
+		ImGui::Spacing();
+
 		if (ImGui::Combo("Heuristic", &m_SelectedHeuristic, "Manhattan\0Euclidean\0SqrtEuclidean\0Octile\0Chebyshev\0", 4))
 		{
 			switch (m_SelectedHeuristic)
@@ -351,8 +793,13 @@ void App_Pathfinding::UpdateImGui()
 				break;
 			}
 
+			//The abstract graph and the incremental search keep the heuristic they were created with
+			SAFE_DELETE(m_pHPAStar);
+			SAFE_DELETE(m_pDStarLite);
 			m_UpdatePath = true;
 		}
+		if (ImGui::Checkbox("ALT landmarks", &m_UseLandmarks))
+			m_UpdatePath = true;
 		ImGui::Spacing();
 
 		//End
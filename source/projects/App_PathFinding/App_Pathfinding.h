@@ -5,6 +5,12 @@
 //-----------------------------------------------------------------
 #include "framework/EliteInterfaces/EIApp.h"
 #include "framework\EliteAI\EliteGraphs\EGridGraph.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\LineOfSightCache.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\HPAStar.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\LandmarkHeuristic.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\DStarLite.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\ARAStar.h"
+#include "framework\EliteAI\EliteGraphs\EliteGraphAlgorithms\BatchPathfinder.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphEditor.h"
 #include "framework\EliteAI\EliteGraphs\EliteGraphUtilities\EGraphRenderer.h"
 
@@ -14,7 +20,17 @@
 
 enum class PathfindingAlgorithm
 {
-	BOTH, ASTAR, THETASTAR
+	BOTH, ASTAR, THETASTAR, JPS, ASTAR_JPS
+};
+
+enum class OpenListType
+{
+	BINARYHEAP, QUATERNARYHEAP, PAIRINGHEAP
+};
+
+enum class AStarVariant
+{
+	ASTAR, BIDIRECTIONAL, HIERARCHICAL, DSTARLITE, ARASTAR
 };
 
 class App_Pathfinding final : public IApp
@@ -46,10 +62,23 @@ private:
 	int endPathIdx = invalid_node_index;
 	std::vector<Elite::GridTerrainNode*> m_vPathAStar;
 	std::vector<Elite::GridTerrainNode*> m_vPathThetaStar;
+	std::vector<Elite::GridTerrainNode*> m_vPathJPS;
 	float m_PathLengthAStar;
 	float m_PathLengthThetaStar;
+	float m_PathLengthJPS;
 	float m_ExecutionTimeAStar;
 	float m_ExecutionTimeThetaStar;
+	float m_ExecutionTimeJPS;
+	int m_NrOfExpandedNodesAStar = 0;
+	int m_NrOfRebuiltClusters = 0;
+	int m_NrOfRepairedNodes = 0;
+	int m_NrOfLineOfSightChecksThetaStar = 0;
+	bool m_LazyThetaStar = false;
+	bool m_UseLineOfSightCache = false;
+	Elite::LineOfSightCache<Elite::GridTerrainNode, Elite::GraphConnection>* m_pLineOfSightCache = nullptr;
+	Elite::LineOfSightCacheStatistics m_LineOfSightCacheStatistics{};
+	bool m_UseJumpTable = false;
+	bool m_CanJump = true;
 	bool m_UpdatePath = true;
 
 	//Editor and Visualisation
@@ -59,15 +88,64 @@ private:
 	//Debug rendering information
 	int m_SelectedHeuristic = 4;
 	int m_SelectedAlgorithm = 0;
+	int m_SelectedOpenList = 0;
 	Elite::Heuristic m_pHeuristicFunction = Elite::HeuristicFunctions::Chebyshev;
 	PathfindingAlgorithm m_PathFindingAlgo;
+	OpenListType m_OpenListType = OpenListType::BINARYHEAP;
 	bool m_bDrawGrid = true;
 	bool m_bDebugRenderPathSearch = false;
 	bool m_StartSelected = true;
 	bool m_SmoothAstar = false;
+	int m_SelectedAStarVariant = 0;
+	AStarVariant m_AStarVariant = AStarVariant::ASTAR;
+	//Kept between updates, so an edit of the grid only rebuilds the clusters it touches
+	Elite::HPAStar<Elite::GridTerrainNode, Elite::GraphConnection>* m_pHPAStar = nullptr;
+	//Kept between updates, so an edit of the grid only repairs the part of the search it affects
+	Elite::DStarLite<Elite::GridTerrainNode, Elite::GraphConnection>* m_pDStarLite = nullptr;
+	//Weighted A*: trades path length for fewer expanded nodes
+	float m_HeuristicWeight = 1.f;
+	//ARA* improves its path until it is optimal or the budget is used up
+	int m_TimeBudgetARAStar = 200; // microseconds
+	float m_SuboptimalityBound = 1.f;
+	bool m_UseLandmarks = false;
+	//Created on first use, the distance tables are recomputed when the grid was edited
+	Elite::LandmarkHeuristic<Elite::GridTerrainNode, Elite::GraphConnection>* m_pLandmarkHeuristic = nullptr;
+
+	//Batch benchmark: random queries on a large grid with random walls, searched by a pool of 1 to 16 threads
+	//The demo grid is too small, its queries end before the pool has handed out more than a few blocks
+	static const int BATCH_BENCHMARK_SIZE = 512; // columns and rows
+	static const int NR_OF_BATCH_QUERIES = 256;
+	std::vector<std::pair<int, float>> m_BatchBenchmarkTimes; // number of threads, seconds for the whole batch
+
+	//Construction benchmark: square grids of growing size, built on one thread, on all hardware threads and as an implicit grid
+	struct ConstructionTime
+	{
+		int size; // columns and rows
+		float time; // seconds
+		float parallelTime;
+		float implicitTime;
+	};
+	std::vector<ConstructionTime> m_ConstructionBenchmarkTimes;
+
+#ifdef _DEBUG
+	//Allocation check: warm A*, smoothing and Theta* queries must not allocate once their buffers have grown
+	static const int NR_OF_ALLOCATION_CHECK_QUERIES = 50;
+	int m_NrOfWarmAllocations = -1; // -1 until the check ran
+#endif
 
 	//Functions
 	void MakeGridGraph();
+	bool IsAStarSelected() const;
+	bool IsThetaStarSelected() const;
+	bool IsJPSSelected() const;
+	// T_Heuristic: the heuristic policy of the A* and Theta* searches, matching m_SelectedHeuristic
+	template<template<class> class T_OpenList, class T_Heuristic>
+	void CalculatePaths();
+	void RunBatchBenchmark();
+	void RunConstructionBenchmark();
+#ifdef _DEBUG
+	void RunAllocationCheck();
+#endif
 	void UpdateImGui();
 
 	//C++ make the class non-copyable